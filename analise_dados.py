@@ -1,10 +1,158 @@
 import pandas as pd
 import matplotlib.pyplot as plt
+import glob
 import os
+import struct
+import sys
 
 # --- CONFIGURAÇÕES ---
 # Nome do arquivo CSV gerado pelo datalogger
 NOME_ARQUIVO_CSV = 'datalog.csv'
+# Nome do arquivo binário (LOG_FORMAT_BINARY); tem prioridade sobre o CSV
+NOME_ARQUIVO_BIN = 'datalog.bin'
+# Versões anteriores do firmware: um arquivo por sessão na raiz do cartão
+PADRAO_ARQUIVOS_SESSAO = 'datalog_*.bin'
+# Uma pasta por sessão (datalog_0001, ...) com os segmentos seg_0000, seg_0001, ...;
+# sem argumento, usa a sessão mais recente
+PADRAO_PASTAS_SESSAO = 'datalog_*'
+PADRAO_SEGMENTOS = 'seg_*'
+
+# --- FORMATO BINÁRIO (lib/log_format.h) ---
+LOG_MAGIC = 0x4C554D49
+LOG_COUNT_UNKNOWN = 0xFFFFFFFF
+LOG_DT_ANCHOR = 0xFFFF
+LOG_BLOCK_MARKER = 0x4B42
+# Início comum a todas as versões: magic, version, header_size,
+# record_size (versão 3: block_samples), odr_hz
+FORMATO_PREFIXO = struct.Struct('<IHHHH')
+# Versão 1: ..., accel_fs_sel, gyro_fs_sel, flags, reserved, accel_offset[3],
+# gyro_offset[3], start_fattime, start_us, record_count
+FORMATO_CABECALHO_V1 = struct.Struct('<IHHHHBBBB3h3hIQI')
+# seq, timestamp_us, accel[3], gyro[3]
+FORMATO_REGISTRO_V1 = struct.Struct('<IQ3h3h')
+# Versão 2: ..., reserved, anchor_interval, reserved2, accel_offset[3],
+# gyro_offset[3], start_fattime, start_us, start_epoch, record_count
+FORMATO_CABECALHO_V2 = struct.Struct('<IHHHHBBBBHH3h3hIQII')
+# dt_us seguido dos eixos, ou LOG_DT_ANCHOR seguido de seq e timestamp_us
+FORMATO_DT = struct.Struct('<H')
+FORMATO_EIXOS = struct.Struct('<3h3h')
+FORMATO_ANCORA = struct.Struct('<IQ')
+# Versão 3: ..., accel_offset[3], gyro_offset[3], start_fattime, start_us,
+# start_epoch, block_count
+FORMATO_CABECALHO_V3 = struct.Struct('<IHHHHBBBB3h3hIQII')
+# Bloco: marker, size, count e a primeira amostra (seq, timestamp_us, eixos)
+FORMATO_BLOCO = struct.Struct('<HHHIQ3h3h')
+FORMATO_CABECALHO = {1: FORMATO_CABECALHO_V1, 2: FORMATO_CABECALHO_V2, 3: FORMATO_CABECALHO_V3}
+COLUNAS = ['numero_amostra', 'timestamp_us', 'accel_x', 'accel_y', 'accel_z', 'giro_x', 'giro_y', 'giro_z']
+
+
+def ler_varint(dados, pos):
+    """Lê um varint em zigzag; retorna (valor, próxima posição)."""
+    valor = deslocamento = 0
+    while True:
+        byte = dados[pos]
+        pos += 1
+        valor |= (byte & 0x7F) << deslocamento
+        deslocamento += 7
+        if not byte & 0x80:
+            return (valor >> 1) ^ -(valor & 1), pos
+
+
+def ler_registros(dados, pos, versao, tam_registro, total, sessao, linhas):
+    """Versões 1 e 2: registros de tamanho fixo. Retorna a posição final."""
+    # Sessão interrompida sem fechar o arquivo: lê até o fim
+    if total == LOG_COUNT_UNKNOWN:
+        total = (len(dados) - pos) // tam_registro
+    # Versão 2: a âncora fixa seq e timestamp da amostra seguinte
+    seq, tempo = 0, 0
+    for _ in range(total):
+        if pos + tam_registro > len(dados):
+            break
+        if versao == 1:
+            linhas.append(FORMATO_REGISTRO_V1.unpack_from(dados, pos) + (sessao,))
+        else:
+            (dt,) = FORMATO_DT.unpack_from(dados, pos)
+            if dt == LOG_DT_ANCHOR:
+                seq, tempo = FORMATO_ANCORA.unpack_from(dados, pos + FORMATO_DT.size)
+            else:
+                tempo += dt
+                eixos = FORMATO_EIXOS.unpack_from(dados, pos + FORMATO_DT.size)
+                linhas.append((seq, tempo) + eixos + (sessao,))
+                seq += 1
+        pos += tam_registro
+    return pos
+
+
+def ler_blocos(dados, pos, total, sessao, linhas):
+    """Versão 3: blocos com quadro-chave e deltas em varint. Retorna a posição final."""
+    lidos = 0
+    while (total == LOG_COUNT_UNKNOWN or lidos < total) and pos + FORMATO_BLOCO.size <= len(dados):
+        marcador, tamanho, quantidade, seq, tempo, *eixos = FORMATO_BLOCO.unpack_from(dados, pos)
+        # Sessão interrompida: o que vier depois do último bloco não é bloco
+        if marcador != LOG_BLOCK_MARKER or pos + tamanho > len(dados):
+            break
+        linhas.append((seq, tempo, *eixos, sessao))
+        p = pos + FORMATO_BLOCO.size
+        dt = 0
+        for _ in range(quantidade - 1):
+            variacao, p = ler_varint(dados, p)
+            dt += variacao
+            seq += 1
+            tempo += dt
+            for i in range(6):
+                delta, p = ler_varint(dados, p)
+                eixos[i] += delta
+            linhas.append((seq, tempo, *eixos, sessao))
+        pos += tamanho
+        lidos += 1
+    return pos
+
+
+def carregar_binario(caminho):
+    """
+    Lê um arquivo binário do datalogger, com uma ou mais sessões.
+
+    Returns:
+        pd.DataFrame: As amostras de todas as sessões, com a coluna 'sessao'.
+    """
+    with open(caminho, 'rb') as f:
+        dados = f.read()
+
+    linhas = []
+    pos = 0
+    sessao = 0
+    while pos + FORMATO_PREFIXO.size <= len(dados):
+        magic, versao, tam_cabecalho, tam_registro, odr_hz = FORMATO_PREFIXO.unpack_from(dados, pos)
+        if magic != LOG_MAGIC or versao not in FORMATO_CABECALHO:
+            raise ValueError(f"Cabeçalho inválido na posição {pos}")
+        campos = FORMATO_CABECALHO[versao].unpack_from(dados, pos)
+        total = campos[-1]
+        epoch = campos[-2] if versao >= 2 else 0
+        print(f"Sessão {sessao}: versão {versao}, {odr_hz} Hz"
+              + (f", início {pd.to_datetime(epoch, unit='s')}" if epoch else ""))
+        pos += tam_cabecalho
+        if versao >= 3:
+            pos = ler_blocos(dados, pos, total, sessao, linhas)
+        else:
+            pos = ler_registros(dados, pos, versao, tam_registro, total, sessao, linhas)
+        sessao += 1
+
+    return pd.DataFrame(linhas, columns=COLUNAS + ['sessao'])
+
+def carregar_sessao(pasta):
+    """
+    Lê todos os segmentos de uma pasta de sessão, na ordem dos nomes.
+
+    Returns:
+        pd.DataFrame: As amostras da sessão, emendadas na ordem de gravação.
+    """
+    for extensao, carregar in (('.bin', carregar_binario), ('.csv', pd.read_csv)):
+        segmentos = sorted(glob.glob(os.path.join(pasta, PADRAO_SEGMENTOS + extensao)))
+        if segmentos:
+            print(f"{len(segmentos)} segmento(s) em '{pasta}'")
+            return pd.concat([carregar(s) for s in segmentos], ignore_index=True)
+    raise ValueError(f"Nenhum segmento em '{pasta}'")
+
 
 def plotar_dados(dataframe):
     """
@@ -17,8 +165,14 @@ def plotar_dados(dataframe):
         print("O arquivo de dados está vazio. Nada para plotar.")
         return
 
-    # Garante que o índice (número da amostra) seja usado como eixo X
-    eixo_x = dataframe['numero_amostra']
+    # Eixo X em segundos desde a primeira amostra quando há timestamp; senão,
+    # o número da amostra (CSV antigo)
+    if 'timestamp_us' in dataframe.columns:
+        eixo_x = (dataframe['timestamp_us'] - dataframe['timestamp_us'].iloc[0]) / 1e6
+        rotulo_x = 'Tempo (s)'
+    else:
+        eixo_x = dataframe['numero_amostra']
+        rotulo_x = 'Número da Amostra'
 
     # Cria a figura e os subplots
     # 2 linhas, 1 coluna, tamanho da figura ajustado para boa visualização
@@ -38,7 +192,7 @@ def plotar_dados(dataframe):
     ax2.plot(eixo_x, dataframe['giro_y'], label='Giro Y', color='m')
     ax2.plot(eixo_x, dataframe['giro_z'], label='Giro Z', color='y')
     ax2.set_title('Dados do Giroscópio', fontsize=16)
-    ax2.set_xlabel('Número da Amostra (Tempo)', fontsize=12)
+    ax2.set_xlabel(rotulo_x, fontsize=12)
     ax2.set_ylabel('Valor Raw do Sensor')
     ax2.legend()
     ax2.grid(True, linestyle='--', alpha=0.6)
@@ -53,6 +207,31 @@ def main():
     """
     Função principal que carrega os dados e chama a função de plotagem.
     """
+    arquivo_bin = None
+    pastas = sorted(p for p in glob.glob(PADRAO_PASTAS_SESSAO) if os.path.isdir(p))
+    if len(sys.argv) > 1:
+        arquivo_bin = sys.argv[1]
+    elif pastas:
+        arquivo_bin = pastas[-1]
+    elif os.path.exists(NOME_ARQUIVO_BIN):
+        arquivo_bin = NOME_ARQUIVO_BIN
+    elif glob.glob(PADRAO_ARQUIVOS_SESSAO):
+        arquivo_bin = sorted(glob.glob(PADRAO_ARQUIVOS_SESSAO))[-1]
+
+    if arquivo_bin:
+        print(f"Carregando os dados de: '{arquivo_bin}'")
+        try:
+            if os.path.isdir(arquivo_bin):
+                dados_df = carregar_sessao(arquivo_bin)
+            else:
+                dados_df = carregar_binario(arquivo_bin)
+        except Exception as e:
+            print(f"\nOcorreu um erro ao processar o arquivo: {e}")
+            return
+        print(f"Total de {len(dados_df)} amostras encontradas.")
+        plotar_dados(dados_df)
+        return
+
     print(f"Tentando carregar os dados do arquivo: '{NOME_ARQUIVO_CSV}'")
     
     # Verifica se o arquivo existe no diretório atual
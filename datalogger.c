@@ -6,17 +6,31 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "hardware/clocks.h"
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/rtc.h"
 #include "ff.h" // Biblioteca FatFs para o sistema de arquivos
 #include "sd_card.h" // Funções de baixo nível para o cartão SD
+#include "hw_config.h"
 
 // Bibliotecas para periféricos
 #include "lib/ssd1306.h"
 #include "lib/font.h"
+#include "lib/sampler.h"
+#include "lib/mpu6050.h"
+#include "lib/i2c_dma.h"
+#include "lib/log_format.h"
+#include "lib/log_writer.h"
+#include "lib/bench.h"
+#include "lib/latency.h"
+#include "lib/feedback.h"
+#include "lib/config_store.h"
 
 // --- CONFIGURAÇÕES DOS PINOS ---
 #define I2C_MPU_PORT    i2c0
@@ -32,26 +46,115 @@
 #define BLUE_LED_PIN    13 
 #define BUTTON_1_PIN    5 // BOTAO_A
 #define BUTTON_2_PIN    6 // BOTAO_B
+#define MPU_INT_PIN     8 // Pino INT do MPU6050 (DATA_RDY)
 #define BUZZER_A_PIN     21
 #define BUZZER_B_PIN     10
 #define BUZZER_FREQUENCY 5000 // Frequência do beep em Hz
 
+// --- CONFIGURAÇÕES DE AQUISIÇÃO ---
+// O sensor divide 1 kHz por um inteiro: só divisores de 1000 são exatos
+#define SAMPLE_RATE_HZ  100 // Taxa de amostragem (até SAMPLER_MAX_ODR_HZ)
+#define USE_MPU_FIFO    1   // 1: esvazia a FIFO do sensor em rajadas; 0: uma leitura por amostra
+#define FIFO_POLL_HZ    20  // Frequência de esvaziamento da FIFO no modo rajada (sobe acima de 320 Hz)
+#define USE_MPU_INT     1   // 1: aquisição disparada pelo DATA_RDY no pino INT; 0: timer
+#define USE_I2C_DMA     1   // 1: rajadas da FIFO e quadros do display via DMA, sem ocupar a CPU
+_Static_assert(MPU6050_MAX_ODR_HZ % SAMPLE_RATE_HZ == 0, "SAMPLE_RATE_HZ deve dividir 1000");
+
+// --- CALIBRAÇÃO ---
+// Quadros pela FIFO a 1 kHz; uma tentativa com desvio padrão acima do
+// limite em algum eixo é tratada como movimento e repetida
+#define CALIB_FRAMES        500  // Quadros por tentativa (0,5 s)
+#define CALIB_MAX_TRIES     5
+#define CALIB_RETRY_MS      300  // Pausa antes de repetir
+#define CALIB_ACCEL_MAX_STD 80   // LSB (±2 g: ~5 mg)
+#define CALIB_GYRO_MAX_STD  40   // LSB (±250 °/s: ~0,3 °/s)
+#define GRAVITY_RAW         16384
+
+// --- CONFIGURAÇÕES DE GRAVAÇÃO ---
+#define LOG_FORMAT_CSV    0 // Texto, compatível com versões antigas do analise_dados.py
+#define LOG_FORMAT_BINARY 1 // Registros compactos (lib/log_format.h)
+#define LOG_FORMAT        LOG_FORMAT_BINARY
+// Cada sessão ganha uma pasta nova (datalog_0001, _0002, ...) e grava em
+// segmentos dentro dela (seg_0000.bin, seg_0001.bin, ...), cada um com seu
+// cabeçalho. Nenhum arquivo é reaberto para anexar: abrir uma gravação
+// custa o mesmo com 10 MB ou 10 GB de histórico no cartão.
+#define LOG_DIR_BASE      "datalog"
+#define LOG_SESSION_MAX   9999 // Pastas de sessão por cartão (4 dígitos)
+#define LOG_SEGMENT_MB    64 // Novo segmento ao chegar a N MB
+#define LOG_SEGMENT_MIN   10 // ... ou a N minutos (0: só pelo tamanho)
+// 1: cada segmento pré-aloca LOG_SEGMENT_MB contíguos e grava os setores
+// direto no cartão, sem atualizar FAT/diretório a cada bloco. 0: o segmento
+// cresce cluster a cluster pelo FatFs
+#define LOG_PREALLOC      1
+#define LOG_SYNC_INTERVAL_MS 1000 // f_sync periódico (0: só ao parar)
+#define LOG_SYNC_KB          0    // f_sync a cada N KB gravados (0: desativado)
+
+// --- CONFIGURAÇÃO PERSISTENTE (lib/config_store.h) ---
+// Só a calibração fica na flash e vale nos boots seguintes: com ela
+// gravada o boot pula a coleta. Taxa, formato e política de f_sync são os
+// #define acima; segurar B2 ao ligar refaz a calibração.
+#define CONFIG_KEY_ACCEL_OFFSET 1 // int32_t[3]
+#define CONFIG_KEY_GYRO_OFFSET  2 // int32_t[3]
+// 3..6: taxa, formato, f_sync e padrões de versões anteriores; apagadas no boot
+#define CONFIG_KEY_STALE_FIRST  3
+#define CONFIG_KEY_STALE_LAST   6
+
+// --- INTERFACE ---
+#define UI_REFRESH_HZ     5 // Limite de atualização do contador de amostras no display
+
+// --- DIAGNÓSTICO ---
+#define RUN_BENCHMARKS    0 // 1: mede a latência do cartão após montar o SD (saída no USB)
+#define BENCH_REPORT_FILE "bench.txt" // Relatório do modo benchmark (segurar B2 e apertar B1)
+#define LATENCY_REPORT_FILE "latency.txt" // Histogramas da última gravação (LATENCY_STATS em lib/latency.h)
+
+// --- COMANDOS ENTRE NÚCLEOS (FIFO do multicore) ---
+#define STORAGE_CMD_START 1 // Núcleo 0 -> 1: arquivo aberto, começar a gravar
+#define STORAGE_CMD_STOP  2 // Núcleo 0 -> 1: esvaziar a fila e fechar o arquivo
+#define STORAGE_READY     3 // Núcleo 1 -> 0: IRQs do cartão assumidas pelo núcleo 1
+#define STORAGE_ALARMS    4 // Alarmes do pool do núcleo 1 (espera de ocupado do cartão)
+
 // --- ESTADOS DO SISTEMA ---
-typedef enum { STATE_INIT, STATE_NO_SD, STATE_READY, STATE_RECORDING, STATE_SAVED } system_state_t;
+typedef enum { STATE_INIT, STATE_NO_SD, STATE_READY, STATE_RECORDING, STATE_SAVED, STATE_BENCHMARK } system_state_t;
 
 // --- VARIÁVEIS GLOBAIS ---
 FATFS fs;
 FIL fil;
 ssd1306_t disp;
+mpu6050_t imu;
+sampler_t sampler;
+i2c_dma_t mpu_bus;
+i2c_dma_t oled_bus;
+mpu6050_frame_t fifo_frames[SAMPLER_MAX_BURST];
 volatile bool button1_pressed = false;
 volatile bool button2_pressed = false;
 volatile system_state_t current_state = STATE_INIT;
-uint32_t sample_count = 0;
+volatile uint32_t sample_count = 0; // Atualizado pelo núcleo 1
+log_writer_t log_writer; // Usado apenas pelo núcleo 1 durante a gravação
+log_encoder_t log_encoder; // Blocos compactados do formato binário (núcleo 1)
+uint32_t log_session = 0;  // Pasta da sessão atual (datalog_NNNN)
+uint32_t log_segment = 0;  // Segmento aberto na pasta (núcleo 1 durante a gravação)
+uint32_t log_segment_blocks = 0; // log_encoder.blocks no início do segmento
+uint64_t log_segment_start_us = 0;
+bool log_segment_failed = false; // Abertura de segmento falhou: gravação parada
 long accel_offset[3] = {0, 0, 0};
 long gyro_offset[3] = {0, 0, 0};
+config_store_t config; // Cópia em RAM da configuração na flash
+
+// Parâmetros de aquisição e gravação em uso
+typedef struct {
+    uint16_t sample_rate_hz;
+    uint8_t log_format;
+    log_sync_policy_t sync;
+} logger_settings_t;
+logger_settings_t settings = { SAMPLE_RATE_HZ, LOG_FORMAT, { LOG_SYNC_INTERVAL_MS, LOG_SYNC_KB * 1024 } };
 
 // --- FUNÇÕES DE CALLBACK PARA INTERRUPÇÕES DOS BOTÕES ---
 void gpio_callback(uint gpio, uint32_t events) {
+    // DATA_RDY do sensor: o instante é capturado antes de qualquer outra coisa
+    if (gpio == MPU_INT_PIN) {
+        sampler_data_ready(&sampler, time_us_64());
+        return;
+    }
     static uint32_t last_irq_time = 0;
     uint32_t current_irq_time = to_ms_since_boot(get_absolute_time());
     if (current_irq_time - last_irq_time > 250) {
@@ -63,10 +166,31 @@ void gpio_callback(uint gpio, uint32_t events) {
 
 // --- FUNÇÕES AUXILIARES ---
 
+// LED e buzzer tocam padrões em segundo plano (lib/feedback.h)
+feedback_channel_t led_channel;
+feedback_channel_t buzzer_channel;
+
+#define LED_RGB(r, g, b) ((uint32_t)(r) << 16 | (uint32_t)(g) << 8 | (b))
+#define BEEP_WRAP        6000 // Tom do bipe (wrap do PWM)
+
+static const feedback_step_t beep_single[] = { { BEEP_WRAP, 150 }, { 0, 0 } };
+static const feedback_step_t beep_double[] = {
+    { BEEP_WRAP, 150 }, { 0, 100 }, { BEEP_WRAP, 150 }, { 0, 0 }
+};
+// Roxo piscando enquanto não há cartão
+static const feedback_step_t led_no_sd[] = {
+    { LED_RGB(128, 0, 128), 250 }, { LED_RGB(0, 0, 0), 250 }, { 0, FEEDBACK_REPEAT }
+};
+
+static void led_output(uint32_t rgb) {
+    gpio_put(RED_LED_PIN, (rgb >> 16) & 0xFF);
+    gpio_put(GREEN_LED_PIN, (rgb >> 8) & 0xFF);
+    gpio_put(BLUE_LED_PIN, rgb & 0xFF);
+}
+
+// Cor fixa: interrompe um padrão em curso
 void set_rgb_led_color(uint8_t r, uint8_t g, uint8_t b) {
-    gpio_put(RED_LED_PIN, r > 0);
-    gpio_put(GREEN_LED_PIN, g > 0);
-    gpio_put(BLUE_LED_PIN, b > 0);
+    feedback_set(&led_channel, LED_RGB(r, g, b));
 }
 
 // Funções do Buzzer baseadas no exemplo funcional
@@ -99,71 +223,459 @@ void stop_beep() {
     pwm_set_gpio_level(BUZZER_B_PIN, 0);
 }
 
+static void buzzer_output(uint32_t wrap) {
+    if (wrap) start_beep(wrap);
+    else stop_beep();
+}
+
+// Retorna na hora; o padrão toca no alarme
 void play_beep(int count) {
-    start_beep(6000); 
-    sleep_ms(150);
-    stop_beep();
-    if (count > 1) {
-        sleep_ms(100);
-        start_beep(6000);
-        sleep_ms(150);
-        stop_beep();
-    }
+    feedback_play(&buzzer_channel, count > 1 ? beep_double : beep_single);
 }
 
+// Textos da tela atual: update_display só redesenha quando mudam
+static char ui_status[24], ui_detail[24];
+
+// Desenha no buffer de desenho e troca sem esperar o barramento: se o
+// quadro anterior ainda estiver saindo, este fica pendente e sai no próximo
+// ssd1306_poll (laço principal ou display_sleep_ms)
 void update_display(const char* status, const char* detail) {
+    if (!detail) detail = "";
+    if (!strcmp(status, ui_status) && !strcmp(detail, ui_detail)) return;
+    snprintf(ui_status, sizeof(ui_status), "%s", status);
+    snprintf(ui_detail, sizeof(ui_detail), "%s", detail);
+    LATENCY_BEGIN(start);
     ssd1306_fill(&disp, 0);
     ssd1306_draw_string(&disp, "Datalogger MPU6050", 0, 0);
     ssd1306_line(&disp, 0, 10, 128, 10, true);
     ssd1306_draw_string(&disp, "Status:", 0, 20);
     ssd1306_draw_string(&disp, status, 0, 32);
-    if (detail) ssd1306_draw_string(&disp, detail, 0, 48);
-    ssd1306_send_data(&disp);
+    ssd1306_draw_string(&disp, detail, 0, 48);
+    ssd1306_present(&disp);
+    LATENCY_END(LAT_DISPLAY, start);
 }
 
-void mpu6050_reset() {
-    uint8_t buf[] = {0x6B, 0x00};
-    i2c_write_blocking(I2C_MPU_PORT, MPU6050_ADDR, buf, 2, false);
+// sleep_ms que entrega um quadro pendente assim que o anterior termina
+// (o fim do quadro dá __sev)
+void display_sleep_ms(uint32_t ms) {
+    absolute_time_t end = make_timeout_time_ms(ms);
+    while (disp.frame_pending && absolute_time_diff_us(get_absolute_time(), end) > 0) {
+        if (!ssd1306_poll(&disp)) __wfe();
+    }
+    sleep_until(end);
 }
 
-void mpu6050_read_raw(int16_t accel[3], int16_t gyro[3]) {
-    uint8_t buffer[6];
-    uint8_t reg;
-    reg = 0x3B;
-    i2c_write_blocking(I2C_MPU_PORT, MPU6050_ADDR, &reg, 1, true);
-    i2c_read_blocking(I2C_MPU_PORT, MPU6050_ADDR, buffer, 6, false);
-    for (int i = 0; i < 3; i++) accel[i] = (buffer[i * 2] << 8 | buffer[i * 2 + 1]);
-    reg = 0x43;
-    i2c_write_blocking(I2C_MPU_PORT, MPU6050_ADDR, &reg, 1, true);
-    i2c_read_blocking(I2C_MPU_PORT, MPU6050_ADDR, buffer, 6, false);
-    for (int i = 0; i < 3; i++) gyro[i] = (buffer[i * 2] << 8 | buffer[i * 2 + 1]);
+// Dorme com __wfe até um evento ou o prazo. Acordam o núcleo as IRQs dos
+// botões, do amostrador e do fim de quadro do display; quem chama reavalia
+// o estado ao retornar. Uma IRQ logo antes do __wfe não se perde: a entrada
+// na exceção já marca o evento.
+void ui_sleep_until(absolute_time_t deadline) {
+    if (ssd1306_poll(&disp)) return;
+    best_effort_wfe_or_timeout(deadline);
 }
 
-void calibrate_imu() {
-    const int num_samples = 1000;
-    int16_t accel_temp[3], gyro_temp[3];
+// Chamada pelo timer do amostrador a cada período
+bool sampler_read_imu(imu_sample_t *sample, void *ctx) {
+    LATENCY_BEGIN(start);
+    bool ok = mpu6050_read_raw(&imu, sample->accel, sample->gyro);
+    LATENCY_END(LAT_I2C_READ, start);
+    if (!ok) return false; // Amostra descartada e contada em read_errors
+    LATENCY_BEGIN(offsets);
     for (int i = 0; i < 3; i++) {
-        accel_offset[i] = 0;
-        gyro_offset[i] = 0;
+        sample->accel[i] -= accel_offset[i];
+        sample->gyro[i] -= gyro_offset[i];
+    }
+    LATENCY_END(LAT_OFFSET, offsets);
+    return true;
+}
+
+void apply_fifo_frames(imu_sample_t *out, int n) {
+    LATENCY_BEGIN(start);
+    for (int f = 0; f < n; f++) {
+        for (int i = 0; i < 3; i++) {
+            out[f].accel[i] = fifo_frames[f].accel[i] - accel_offset[i];
+            out[f].gyro[i] = fifo_frames[f].gyro[i] - gyro_offset[i];
+        }
+    }
+    LATENCY_END(LAT_OFFSET, start);
+}
+
+#if USE_I2C_DMA
+#if LATENCY_STATS
+static uint32_t fifo_read_start_us; // Início da rajada assíncrona em voo
+#endif
+
+// Fim da rajada assíncrona, no contexto da IRQ do i2c0
+void imu_fifo_done(mpu6050_t *mpu, int n, void *user) {
+#if LATENCY_STATS
+    latency_record(LAT_I2C_READ, time_us_32() - fifo_read_start_us);
+#endif
+    apply_fifo_frames((imu_sample_t *)user, n);
+    sampler_burst_done(&sampler, n);
+}
+#endif
+
+// Modo rajada: esvazia a FIFO do MPU6050 em poucas transações I2C
+int sampler_read_imu_fifo(imu_sample_t *out, int max, void *ctx) {
+#if USE_I2C_DMA
+    if (imu.dma) {
+#if LATENCY_STATS
+        fifo_read_start_us = time_us_32();
+#endif
+        if (!mpu6050_fifo_read_async(&imu, fifo_frames, max, imu_fifo_done, out)) return -1;
+        return SAMPLER_BURST_ASYNC;
     }
+#endif
+    LATENCY_BEGIN(start);
+    int n = mpu6050_fifo_read(&imu, fifo_frames, max);
+    LATENCY_END(LAT_I2C_READ, start);
+    apply_fifo_frames(out, n);
+    return n;
+}
+
+void print_sampler_stats() {
+    sampler_stats_t st;
+    sampler_get_stats(&sampler, &st);
+    printf("Amostrador: %lu disparos, %lu perdidas, %lu erros, %lu atrasadas\n",
+           st.ticks, st.dropped, st.read_errors, st.late);
+    printf("Fila: pico de %lu/%d amostras\n", st.ring_high_water, SAMPLER_RING_LEN);
+#if USE_MPU_FIFO
+    printf("FIFO MPU6050: %lu quadros em %lu rajadas, %lu estouros\n",
+           imu.fifo_frames, imu.fifo_bursts, imu.fifo_overflows);
+#endif
+    printf("Jitter (us): min %ld, max %ld, medio %lu\n",
+           st.jitter_min_us, st.jitter_max_us, st.jitter_avg_us);
+    log_writer_stats_t ws;
+    log_writer_get_stats(&log_writer, &ws);
+    printf("Gravacao: %lu bytes em %lu f_write, %lu f_sync, %lu erros\n",
+           ws.bytes, ws.writes, ws.syncs, ws.errors);
+    if (ws.retries) printf("Gravacao: %lu lotes regravados apos falha na IRQ\n", ws.retries);
+    if (sample_count && ws.elapsed_ms)
+        printf("Gravacao: %lu bytes/amostra, %lu.%02lu f_sync/s\n", ws.bytes / sample_count,
+               ws.syncs * 1000 / ws.elapsed_ms, (ws.syncs * 100000 / ws.elapsed_ms) % 100);
+    if (log_encoder.samples) {
+        // Em centésimos; a taxa compara com LOG_RAW_SAMPLE_SIZE por amostra
+        uint32_t per_sample = (uint32_t)((uint64_t)log_encoder.bytes * 100 / log_encoder.samples);
+        uint32_t ratio = (uint32_t)((uint64_t)log_encoder.samples * LOG_RAW_SAMPLE_SIZE * 100 /
+                                    log_encoder.bytes);
+        printf("Compressao: %lu amostras em %lu blocos, %lu.%02lu bytes/amostra (%lu.%02lu:1)\n",
+               log_encoder.samples, log_encoder.blocks, per_sample / 100, per_sample % 100,
+               ratio / 100, ratio % 100);
+    }
+    if (ws.stream_blocks)
+        printf("Gravacao: %lu blocos em CMD25 continuo, %lu reaberturas\n",
+               ws.stream_blocks, ws.stream_reopens);
+    if (disp.frames)
+        printf("Display: %lu quadros (%lu inteiros, %lu adiados), %lu bytes enviados, %lu economizados\n",
+               disp.frames, disp.full_frames, disp.frames_deferred, disp.bytes_sent, disp.bytes_saved);
+#if USE_I2C_DMA
+    printf("I2C DMA: sensor %lu transacoes (%lu abortadas), display %lu (%lu abortadas)\n",
+           mpu_bus.completed, mpu_bus.aborted, oled_bus.completed, oled_bus.aborted);
+#endif
+}
+
+// Fim do segmento: o bloco incompleto do codificador vai para o gravador
+void flush_log_block() {
+    const uint8_t *block;
+    size_t len = log_encoder_flush(&log_encoder, &block);
+    if (len) log_writer_append(&log_writer, block, len);
+}
+
+// Cria o próximo segmento da pasta da sessão, com o cabeçalho no início
+FRESULT open_log_segment() {
+    char name[32];
+    sprintf(name, LOG_DIR_BASE "_%04lu/seg_%04lu%s", log_session, log_segment,
+            settings.log_format == LOG_FORMAT_BINARY ? ".bin" : ".csv");
+    FRESULT fr = f_open(&fil, name, FA_CREATE_NEW | FA_WRITE);
+    if (fr != FR_OK) return fr;
+    // Sem espaço contíguo o gravador segue com f_write no mesmo arquivo
+    FSIZE_t capacity = LOG_PREALLOC ? (FSIZE_t)LOG_SEGMENT_MB * 1024 * 1024 : 0;
+    if (log_writer_open(&log_writer, &fil, capacity) != FR_OK)
+        printf("%s: sem espaco contiguo, gravando com f_write\n", name);
+    log_segment_start_us = time_us_64();
+    log_segment_blocks = log_encoder.blocks;
+
+    // O cabeçalho segue pelo mesmo caminho dos registros
+    if (settings.log_format == LOG_FORMAT_BINARY) {
+        log_file_header_t header;
+        uint8_t flags = (USE_MPU_FIFO ? LOG_FLAG_FIFO : 0) | (USE_MPU_INT ? LOG_FLAG_INT_TRIGGER : 0);
+        // Hora Unix pelo rtc.c do driver; 0 enquanto o RTC não tiver data
+        uint32_t epoch = rtc_running() ? (uint32_t)time(NULL) : 0;
+        log_header_init(&header, imu.odr_hz, flags, accel_offset, gyro_offset,
+                        get_fattime(), epoch, time_us_64());
+        log_writer_append(&log_writer, &header, sizeof(header));
+    } else {
+        static const char csv_header[] = "numero_amostra,accel_x,accel_y,accel_z,giro_x,giro_y,giro_z,timestamp_us\n";
+        log_writer_append(&log_writer, csv_header, sizeof(csv_header) - 1);
+    }
+    fr = log_writer_sync(&log_writer);
+    if (fr != FR_OK) {
+        // Encerra também o CMD25 do modo contíguo: o arquivo vai ser fechado
+        log_writer_end(&log_writer);
+        f_close(&fil);
+    }
+    return fr;
+}
+
+// Maior número entre as pastas datalog_NNNN da raiz (0: nenhuma)
+static uint32_t last_log_session() {
+    DIR dir;
+    FILINFO fno;
+    uint32_t last = 0;
+    FRESULT fr = f_findfirst(&dir, &fno, "", LOG_DIR_BASE "_????");
+    while (fr == FR_OK && fno.fname[0]) {
+        if (fno.fattrib & AM_DIR) {
+            uint32_t n = 0;
+            for (const char *p = fno.fname + sizeof(LOG_DIR_BASE); *p >= '0' && *p <= '9'; p++)
+                n = n * 10 + (*p - '0');
+            if (n > last) last = n;
+        }
+        fr = f_findnext(&dir, &fno);
+    }
+    f_closedir(&dir);
+    return last;
+}
+
+// Nova sessão: a pasta seguinte à de maior número. A raiz só é percorrida
+// uma vez, na primeira gravação depois do boot, ou de novo se a pasta já
+// existir (outro cartão): iniciar não fica mais lento com as sessões
+// acumuladas. FR_DENIED ao chegar a LOG_SESSION_MAX.
+FRESULT open_log_file() {
+    char name[16];
+    FRESULT fr;
+    for (int attempt = 0;; attempt++) {
+        if (!log_session || attempt) log_session = last_log_session();
+        if (log_session >= LOG_SESSION_MAX) return FR_DENIED;
+        sprintf(name, LOG_DIR_BASE "_%04lu", log_session + 1);
+        fr = f_mkdir(name);
+        if (fr != FR_EXIST || attempt) break;
+    }
+    if (fr != FR_OK) return fr;
+    log_session++;
+    log_segment = 0;
+    log_segment_failed = false;
+    log_encoder_reset(&log_encoder);
+    log_writer_begin(&log_writer, &settings.sync);
+    return open_log_segment();
+}
+
+// Grava o total de blocos no cabeçalho do segmento e fecha o arquivo
+FRESULT close_log_file() {
+    if (settings.log_format == LOG_FORMAT_BINARY) {
+        uint32_t count = log_encoder.blocks - log_segment_blocks;
+        UINT bw;
+        if (f_lseek(&fil, LOG_HEADER_COUNT_OFFSET) == FR_OK)
+            f_write(&fil, &count, sizeof(count), &bw);
+    }
+    return f_close(&fil);
+}
+
+// O segmento atual chegou ao limite de tamanho ou de tempo. A folga de um
+// bloco e um setor mantém a próxima escrita dentro da extensão pré-alocada.
+bool log_segment_due() {
+    if (log_segment_failed) return false;
+    if (log_writer_size(&log_writer) + LOG_BLOCK_MAX + LOG_WRITER_SECTOR >
+        (FSIZE_t)LOG_SEGMENT_MB * 1024 * 1024) return true;
+    return LOG_SEGMENT_MIN &&
+           time_us_64() - log_segment_start_us >= (uint64_t)LOG_SEGMENT_MIN * 60 * 1000000;
+}
+
+// Fecha o segmento e abre o seguinte na mesma pasta (núcleo 1). O bloco
+// aberto fecha antes, então cada segmento se decodifica sozinho.
+void next_log_segment() {
+    flush_log_block();
+    log_writer_end(&log_writer);
+    close_log_file();
+    log_segment++;
+    if (open_log_segment() != FR_OK) {
+        // Sem arquivo aberto as amostras seguintes só contam como erro do gravador
+        log_segment_failed = true;
+        printf("Falha ao abrir o segmento %lu\n", log_segment);
+    }
+}
+
+// Grava no cartão todas as amostras pendentes na fila do amostrador.
+// Retorna quantas amostras foram gravadas.
+uint32_t drain_samples() {
+    imu_sample_t sample;
+    uint32_t written = 0;
+    // Os registros vão para o buffer de escrita adiada, que só chama o
+    // f_write em múltiplos de setor
+    if (settings.log_format == LOG_FORMAT_BINARY) {
+        const uint8_t *block;
+        while (sampler_pop(&sampler, &sample)) {
+            if (log_segment_due()) next_log_segment();
+            LATENCY_BEGIN(start);
+            size_t len = log_encode(&log_encoder, &sample, &block);
+            LATENCY_END(LAT_FORMAT, start);
+            if (len) log_writer_append(&log_writer, block, len);
+            written++;
+        }
+    } else {
+        char file_buffer[128];
+        while (sampler_pop(&sampler, &sample)) {
+            if (log_segment_due()) next_log_segment();
+            LATENCY_BEGIN(start);
+            int len = sprintf(file_buffer, "%lu,%d,%d,%d,%d,%d,%d,%llu\n", 
+                              sample.seq, sample.accel[0], sample.accel[1], sample.accel[2],
+                              sample.gyro[0], sample.gyro[1], sample.gyro[2], sample.timestamp_us);
+            LATENCY_END(LAT_FORMAT, start);
+            log_writer_append(&log_writer, file_buffer, len);
+            written++;
+        }
+    }
+    sample_count += written;
+    return written;
+}
+
+// --- NÚCLEO 1: GRAVAÇÃO NO CARTÃO SD ---
+// Durante a gravação todo acesso ao FatFs acontece aqui, de modo que um
+// cartão ocupado por centenas de ms nunca atrasa a aquisição no núcleo 0.
+// A IRQ de DMA do SPI e os alarmes da escrita assíncrona também são
+// tratados aqui: um pool de alarmes próprio e o NVIC deste núcleo.
+void core1_storage_entry() {
+    sd_async_set_alarm_pool(alarm_pool_create_with_unused_hardware_alarm(STORAGE_ALARMS));
+    my_spi_set_irq_enabled(true);
+    multicore_fifo_push_blocking(STORAGE_READY);
+    while (1) {
+        // O gravador já foi iniciado por open_log_file no núcleo 0
+        if (multicore_fifo_pop_blocking() != STORAGE_CMD_START) continue;
+        while (!multicore_fifo_rvalid()) {
+            if (!drain_samples()) sleep_us(500);
+            log_writer_poll(&log_writer);
+        }
+        multicore_fifo_pop_blocking(); // STORAGE_CMD_STOP
+        drain_samples();
+        flush_log_block();
+        log_writer_end(&log_writer);
+        multicore_fifo_push_blocking(close_log_file());
+    }
+}
+
+// Quanto a pior variância passa do limite do seu eixo, em milésimos
+// (até 1000: parado)
+static uint32_t calib_motion(const mpu6050_stats_t *st) {
+    uint32_t worst = 0;
+    for (int i = 0; i < MPU6050_AXES; i++) {
+        uint32_t limit = i < 3 ? CALIB_ACCEL_MAX_STD * CALIB_ACCEL_MAX_STD
+                               : CALIB_GYRO_MAX_STD * CALIB_GYRO_MAX_STD;
+        uint32_t score = (uint32_t)((uint64_t)mpu6050_stats_var(st, i) * 1000 / limit);
+        if (score > worst) worst = score;
+    }
+    return worst;
+}
+
+// Retorna false se nenhuma tentativa ficou parada
+bool calibrate_imu() {
+    mpu6050_stats_t st, best;
+    uint32_t best_motion = UINT32_MAX;
+    int tries = 0;
     update_display("Calibrando...", "Nao mova!");
     set_rgb_led_color(255, 165, 0); // Laranja
-    for (int i = 0; i < num_samples; i++) {
-        mpu6050_read_raw(accel_temp, gyro_temp);
-        for (int j = 0; j < 3; j++) {
-            accel_offset[j] += accel_temp[j];
-            gyro_offset[j] += gyro_temp[j];
+    while (tries < CALIB_MAX_TRIES) {
+        tries++;
+        mpu6050_stats_reset(&st);
+        bool ok = mpu6050_collect_stats(&imu, CALIB_FRAMES, &st);
+        uint32_t motion = ok ? calib_motion(&st) : UINT32_MAX;
+        printf("Calibracao %d: %lu quadros, movimento %lu/1000\n", tries, st.n, motion);
+        if (motion < best_motion) {
+            best = st;
+            best_motion = motion;
         }
-        sleep_ms(2);
+        if (motion <= 1000) break;
+        // Movimento (ou sensor mudo): avisa e tenta de novo
+        char detail[20];
+        sprintf(detail, "Movimento! %d/%d", tries, CALIB_MAX_TRIES);
+        update_display("Calibrando...", detail);
+        play_beep(1);
+        display_sleep_ms(CALIB_RETRY_MS);
     }
+
+    // Sem nenhuma tentativa parada, fica a mais calma, com aviso
     for (int i = 0; i < 3; i++) {
-        accel_offset[i] /= num_samples;
-        gyro_offset[i] /= num_samples;
+        accel_offset[i] = best_motion == UINT32_MAX ? 0 : mpu6050_stats_mean(&best, i);
+        gyro_offset[i] = best_motion == UINT32_MAX ? 0 : mpu6050_stats_mean(&best, i + 3);
     }
-    #define GRAVITY_RAW 16384
     accel_offset[2] -= GRAVITY_RAW;
-    update_display("Calibrado!", "Pronto.");
-    sleep_ms(1500);
+    if (best_motion <= 1000) {
+        update_display("Calibrado!", "Pronto.");
+    } else {
+        update_display("Calibrado!", "Com movimento");
+        play_beep(2);
+    }
+    display_sleep_ms(1000);
+    return best_motion <= 1000;
+}
+
+// --- AMOSTRADOR ---
+
+// Amostras por rajada da FIFO: as acumuladas em 1/FIFO_POLL_HZ, até metade
+// do buffer de rajada. Acima de 320 Hz as rajadas ficam mais frequentes.
+static uint32_t fifo_watermark(uint32_t odr_hz) {
+    uint32_t n = odr_hz / FIFO_POLL_HZ;
+    if (n > SAMPLER_MAX_BURST / 2) n = SAMPLER_MAX_BURST / 2;
+    return n ? n : 1;
+}
+
+
+// Configura o amostrador para odr_hz; false se a taxa não for aceita
+static bool init_sampler(uint32_t odr_hz) {
+#if USE_MPU_FIFO
+    uint32_t watermark = fifo_watermark(odr_hz);
+    if (!sampler_init_burst(&sampler, odr_hz, odr_hz / watermark, sampler_read_imu_fifo, NULL))
+        return false;
+#else
+    uint32_t watermark = 1;
+    if (!sampler_init(&sampler, odr_hz, sampler_read_imu, NULL)) return false;
+#endif
+#if USE_MPU_INT
+    // Com a FIFO, o limiar emula a interrupção de nível da FIFO, que o
+    // MPU6050 não possui: uma rajada a cada N interrupções DATA_RDY.
+    return sampler_set_external_trigger(&sampler, watermark);
+#else
+    (void)watermark;
+    return true;
+#endif
+}
+
+// --- CONFIGURAÇÃO NA FLASH ---
+
+// Aplica a calibração da cópia carregada; retorna true se havia uma.
+// Entradas de versões anteriores são apagadas da flash uma única vez.
+bool apply_config() {
+    bool stale = false;
+    for (uint8_t key = CONFIG_KEY_STALE_FIRST; key <= CONFIG_KEY_STALE_LAST; key++)
+        stale |= config_store_remove(&config, key);
+
+    int32_t accel[3], gyro[3];
+    if (!config_store_get(&config, CONFIG_KEY_ACCEL_OFFSET, accel, sizeof(accel)) ||
+        !config_store_get(&config, CONFIG_KEY_GYRO_OFFSET, gyro, sizeof(gyro)))
+        return false;
+    for (int i = 0; i < 3; i++) {
+        accel_offset[i] = accel[i];
+        gyro_offset[i] = gyro[i];
+    }
+    // Sem calibração as entradas vão embora com a próxima save_config()
+    if (stale && config_store_commit(&config))
+        printf("Configuracao: parametros de versoes anteriores removidos (versao %lu)\n", config.seq);
+    return true;
+}
+
+// Grava a calibração como nova versão. Só antes de
+// lançar o núcleo 1: a flash sai do XIP durante a gravação.
+bool save_config() {
+    int32_t accel[3], gyro[3];
+    for (int i = 0; i < 3; i++) {
+        accel[i] = (int32_t)accel_offset[i];
+        gyro[i] = (int32_t)gyro_offset[i];
+    }
+    config_store_set(&config, CONFIG_KEY_ACCEL_OFFSET, accel, sizeof(accel));
+    config_store_set(&config, CONFIG_KEY_GYRO_OFFSET, gyro, sizeof(gyro));
+    uint32_t start = time_us_32();
+    bool ok = config_store_commit(&config);
+    printf("Configuracao: versao %lu %s em %lu us (%lu setores apagados)\n", config.seq,
+           ok ? "gravada" : "NAO gravada", time_us_32() - start, config.erases);
+    return ok;
 }
 
 // --- FUNÇÃO PRINCIPAL ---
@@ -176,7 +688,7 @@ int main() {
     gpio_set_dir(GREEN_LED_PIN, GPIO_OUT);
     gpio_init(BLUE_LED_PIN);
     gpio_set_dir(BLUE_LED_PIN, GPIO_OUT);
-    set_rgb_led_color(255, 255, 0); // Amarelo
+    feedback_init(&led_channel, led_output, LED_RGB(255, 255, 0)); // Amarelo
 
     i2c_init(I2C_OLED_PORT, 400 * 1000);
     gpio_set_function(I2C_OLED_SDA, GPIO_FUNC_I2C);
@@ -185,18 +697,13 @@ int main() {
     gpio_pull_up(I2C_OLED_SCL);
     ssd1306_init(&disp, 128, 64, false, OLED_ADDR, I2C_OLED_PORT);
     ssd1306_config(&disp);
+#if USE_I2C_DMA
+    if (i2c_dma_init(&oled_bus, I2C_OLED_PORT)) ssd1306_attach_dma(&disp, &oled_bus);
+#endif
     update_display("Inicializando", "Aguarde...");
 
     init_buzzer_pwm();
-
-    i2c_init(I2C_MPU_PORT, 400 * 1000);
-    gpio_set_function(I2C_MPU_SDA, GPIO_FUNC_I2C);
-    gpio_set_function(I2C_MPU_SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(I2C_MPU_SDA);
-    gpio_pull_up(I2C_MPU_SCL);
-    mpu6050_reset();
-
-    calibrate_imu();
+    feedback_init(&buzzer_channel, buzzer_output, 0);
 
     gpio_init(BUTTON_1_PIN);
     gpio_set_dir(BUTTON_1_PIN, GPIO_IN);
@@ -205,25 +712,73 @@ int main() {
     gpio_set_dir(BUTTON_2_PIN, GPIO_IN);
     gpio_pull_up(BUTTON_2_PIN);
 
+    // Versão mais recente da configuração: só leitura pelo XIP. Com B2
+    // pressionado a calibração é refeita; a posição na flash é mantida para
+    // o rodízio das páginas.
+    uint32_t config_start = time_us_32();
+    bool calibrated = false;
+    config_store_load(&config);
+    if (!gpio_get(BUTTON_2_PIN)) config_store_clear(&config);
+    else calibrated = apply_config();
+    printf("Configuracao: versao %lu lida em %lu us, %s\n", config.seq,
+           time_us_32() - config_start, calibrated ? "calibracao da flash" : "calibrando");
+
+    i2c_init(I2C_MPU_PORT, 400 * 1000);
+    gpio_set_function(I2C_MPU_SDA, GPIO_FUNC_I2C);
+    gpio_set_function(I2C_MPU_SCL, GPIO_FUNC_I2C);
+    gpio_pull_up(I2C_MPU_SDA);
+    gpio_pull_up(I2C_MPU_SCL);
+    mpu6050_init(&imu, I2C_MPU_PORT, MPU6050_ADDR);
+    mpu6050_reset(&imu);
+    mpu6050_set_odr(&imu, settings.sample_rate_hz);
+
+    if (calibrated) update_display("Calibrado!", "Da flash");
+    else if (calibrate_imu()) save_config();
+#if USE_I2C_DMA
+    if (i2c_dma_init(&mpu_bus, I2C_MPU_PORT)) mpu6050_attach_dma(&imu, &mpu_bus);
+#endif
+
     gpio_set_irq_enabled_with_callback(BUTTON_1_PIN, GPIO_IRQ_EDGE_FALL, true, &gpio_callback);
     gpio_set_irq_enabled_with_callback(BUTTON_2_PIN, GPIO_IRQ_EDGE_FALL, true, &gpio_callback);
 
+    // O amostrador e o cabeçalho do log usam a taxa que o sensor aplicou.
+    // Taxa recusada pelo amostrador: sem ele, não há o que gravar
+    if (!init_sampler(imu.odr_hz)) {
+        printf("SAMPLE_RATE_HZ invalido: %u Hz recusado pelo amostrador\n", imu.odr_hz);
+        update_display("ERRO", "Taxa invalida");
+        set_rgb_led_color(255, 0, 0);
+        while (1) sleep_ms(1000);
+    }
+#if USE_MPU_INT
+    mpu6050_config_int_pin(&imu, 0); // Ativo em nível alto, push-pull, pulso de 50 us
+    gpio_init(MPU_INT_PIN);
+    gpio_set_dir(MPU_INT_PIN, GPIO_IN);
+    gpio_pull_down(MPU_INT_PIN);
+    gpio_set_irq_enabled_with_callback(MPU_INT_PIN, GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
+#endif
+    // O SPI é configurado aqui, mas sua IRQ passa para o núcleo 1
     sd_init_driver();
+    my_spi_set_irq_enabled(false);
+    multicore_launch_core1(core1_storage_entry);
+    multicore_fifo_pop_blocking(); // STORAGE_READY
+
     FRESULT fr = f_mount(&fs, "", 1);
     current_state = (fr == FR_OK) ? STATE_READY : STATE_NO_SD;
+#if RUN_BENCHMARKS
+    if (fr == FR_OK) bench_sd_command_latency(sd_get_by_num(0), 1000);
+    bench_crc16(1000);
+#endif
 
-    int16_t acceleration[3], gyroscope[3];
-    char file_buffer[128];
     char display_detail[20];
+    absolute_time_t ui_next = get_absolute_time(); // Próxima atualização do contador
 
     while (1) {
+        ssd1306_poll(&disp);
         switch (current_state) {
             case STATE_NO_SD:
-                set_rgb_led_color(128, 0, 128);
+                if (!feedback_busy(&led_channel)) feedback_play(&led_channel, led_no_sd);
                 update_display("ERRO", "SD Nao Detectado");
-                sleep_ms(250);
-                set_rgb_led_color(0, 0, 0);
-                sleep_ms(250);
+                ui_sleep_until(at_the_end_of_time);
                 if (button2_pressed) {
                     button2_pressed = false;
                     update_display("Montando SD...", "");
@@ -235,17 +790,41 @@ int main() {
             case STATE_READY:
                 set_rgb_led_color(0, 255, 0);
                 update_display("Aguardando", "Pressione B1");
-                if (button1_pressed) {
+                ui_sleep_until(at_the_end_of_time);
+                // B1 com B2 pressionado: modo benchmark
+                if (button1_pressed && !gpio_get(BUTTON_2_PIN)) {
+                    button1_pressed = false;
+                    button2_pressed = false;
+                    current_state = STATE_BENCHMARK;
+                } else if (button1_pressed) {
                     button1_pressed = false;
                     play_beep(1);
                     set_rgb_led_color(0, 0, 255);
                     update_display("Iniciando...", "Abrindo arquivo");
-                    fr = f_open(&fil, "datalog.csv", FA_OPEN_APPEND | FA_WRITE);
+                    sample_count = 0;
+                    fr = open_log_file();
                     if (fr == FR_OK) {
-                        if (f_size(&fil) == 0) f_puts("numero_amostra,accel_x,accel_y,accel_z,giro_x,giro_y,giro_z\n", &fil);
-                        f_sync(&fil);
-                        sample_count = 0;
+#if LATENCY_STATS
+                        latency_reset(); // Só o laço de gravação entra nos histogramas
+#endif
+                        multicore_fifo_push_blocking(STORAGE_CMD_START);
+#if USE_MPU_FIFO
+                        mpu6050_fifo_enable(&imu);
+#endif
+                        sampler_start(&sampler);
+#if USE_MPU_INT
+                        mpu6050_enable_interrupts(&imu, MPU6050_INT_DATA_RDY);
+#endif
+                        ui_next = get_absolute_time();
                         current_state = STATE_RECORDING;
+                    } else if (fr == FR_DENIED && log_session >= LOG_SESSION_MAX) {
+                        // O cartão está bom: só não cabem mais pastas de sessão
+                        printf("Limite de %d sessoes no cartao\n", LOG_SESSION_MAX);
+                        update_display("Cartao cheio", "Limite de sessoes");
+                        play_beep(2);
+                        display_sleep_ms(3000);
+                        button1_pressed = button2_pressed = false;
+                        current_state = STATE_READY;
                     } else {
                         current_state = STATE_NO_SD;
                     }
@@ -254,37 +833,65 @@ int main() {
 
             case STATE_RECORDING:
                 set_rgb_led_color(255, 0, 0);
-                mpu6050_read_raw(acceleration, gyroscope);
-                sample_count++;
-                for (int i = 0; i < 3; i++) {
-                    acceleration[i] -= accel_offset[i];
-                    gyroscope[i] -= gyro_offset[i];
+                // A aquisição roda no timer e a gravação no núcleo 1; o
+                // contador vai para o display no máximo UI_REFRESH_HZ vezes por segundo
+                if (time_reached(ui_next)) {
+                    sprintf(display_detail, "Amostras: %lu", sample_count);
+                    update_display("Gravando...", display_detail);
+                    ui_next = make_timeout_time_ms(1000 / UI_REFRESH_HZ);
                 }
-                sprintf(file_buffer, "%lu,%d,%d,%d,%d,%d,%d\n", 
-                        sample_count, acceleration[0], acceleration[1], acceleration[2],
-                        gyroscope[0], gyroscope[1], gyroscope[2]);
-                set_rgb_led_color(0, 0, 255);
-                f_puts(file_buffer, &fil);
-                f_sync(&fil);
-                sprintf(display_detail, "Amostras: %lu", sample_count);
-                update_display("Gravando...", display_detail);
+                ui_sleep_until(ui_next);
                 if (button1_pressed) {
                     button1_pressed = false;
+                    // Para o amostrador antes de tocar no barramento do sensor:
+                    // a IRQ de DATA_RDY também usa o i2c0
+                    sampler_stop(&sampler);
+#if USE_MPU_INT
+                    mpu6050_enable_interrupts(&imu, 0);
+#endif
+#if USE_MPU_FIFO
+                    mpu6050_fifo_disable(&imu);
+#endif
+                    multicore_fifo_push_blocking(STORAGE_CMD_STOP);
                     play_beep(2);
                     set_rgb_led_color(0, 0, 255);
-                    f_close(&fil);
+                    multicore_fifo_pop_blocking(); // Aguarda o f_close no núcleo 1
+                    print_sampler_stats();
+#if LATENCY_STATS
+                    latency_report(LATENCY_REPORT_FILE); // Núcleo 1 ocioso: o FatFs é nosso
+#endif
                     current_state = STATE_SAVED;
                 }
-                sleep_ms(100);
                 break;
                 
             case STATE_SAVED:
                 set_rgb_led_color(0, 255, 0);
                 update_display("Dados Salvos!", "");
-                sleep_ms(2000);
+                display_sleep_ms(2000);
                 current_state = STATE_READY;
                 break;
                 
+            case STATE_BENCHMARK: {
+                // O núcleo 1 está ocioso: o FatFs pode ser usado aqui
+                set_rgb_led_color(255, 255, 0);
+                update_display("Benchmark...", "Nao desligue");
+                bench_result_t result;
+                fr = bench_run_report(BENCH_REPORT_FILE, &imu, &disp, &result);
+                if (fr == FR_OK) {
+                    sprintf(display_detail, "Max ~%lu Hz", result.max_rate_hz);
+                    update_display("Benchmark OK", display_detail);
+                    play_beep(1);
+                } else {
+                    sprintf(display_detail, "Erro SD %d", fr);
+                    update_display("Benchmark", display_detail);
+                    play_beep(2);
+                }
+                display_sleep_ms(3000);
+                button1_pressed = button2_pressed = false;
+                current_state = STATE_READY;
+                break;
+            }
+
             case STATE_INIT:
                  sleep_ms(100);
                  break;
@@ -0,0 +1,67 @@
+#pragma once
+
+// Dispositivos simulados ligados aos barramentos de sim_periph.c
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CARTÃO SD (modo SPI, SDHC) ---
+// Os setores ficam num arquivo de imagem esparso. O tempo de programação
+// é devolvido ao firmware como ocupado (MISO em 0x00), como num cartão real.
+typedef struct {
+    uint32_t read_us;          // Latência até o token de um bloco lido
+    uint32_t block_write_us;   // Programação de cada bloco de um CMD25
+    uint32_t single_write_us;  // Programação de um CMD24
+    uint32_t stop_us;          // Ocupado após o Stop Tran do CMD25
+    uint32_t stall_every;      // A cada N blocos gravados, uma pausa longa (0: nunca)
+    uint32_t stall_us;         // Duração da pausa (coleta de lixo do controlador)
+} sd_model_timing_t;
+
+typedef struct {
+    uint32_t cmds;
+    uint64_t blocks_read;
+    uint64_t blocks_written;
+    uint32_t crc_errors;       // Comandos e blocos rejeitados pelo CRC
+    uint32_t stalls;
+    uint64_t busy_ns;          // Tempo total ocupado programando
+} sd_model_stats_t;
+
+typedef struct sd_model sd_model_t;
+
+// Cria a imagem se não existir (size_bytes > 0); retorna NULL em erro
+sd_model_t *sd_model_open(const char *path, uint64_t size_bytes, const sd_model_timing_t *timing);
+void sd_model_attach(sd_model_t *sd, unsigned spi_bus, unsigned cs_gpio);
+void sd_model_get_stats(const sd_model_t *sd, sd_model_stats_t *stats);
+void sd_model_close(sd_model_t *sd);
+
+// --- MPU6050 ---
+// FIFO, DATA_RDY no pino INT e registradores de dados gerados a partir do
+// relógio virtual: o sensor não depende de quando o firmware o lê.
+typedef struct mpu6050_model mpu6050_model_t;
+
+typedef struct {
+    uint32_t frames;           // Quadros que entraram na FIFO
+    uint32_t overflows;        // Quadros descartados por FIFO cheia
+    uint32_t int_pulses;
+} mpu6050_model_stats_t;
+
+mpu6050_model_t *mpu6050_model_create(unsigned i2c_bus, uint8_t addr, unsigned int_gpio);
+// Amplitude do movimento simulado em LSB (0: sensor parado)
+void mpu6050_model_set_motion(mpu6050_model_t *mpu, int amplitude);
+void mpu6050_model_get_stats(const mpu6050_model_t *mpu, mpu6050_model_stats_t *stats);
+
+// --- SSD1306 ---
+typedef struct ssd1306_model ssd1306_model_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint64_t data_bytes;       // Bytes gravados na GDDRAM
+    uint32_t commands;
+} ssd1306_model_stats_t;
+
+ssd1306_model_t *ssd1306_model_create(unsigned i2c_bus, uint8_t addr);
+void ssd1306_model_get_stats(const ssd1306_model_t *oled, ssd1306_model_stats_t *stats);
+// GDDRAM em [página][coluna]
+const uint8_t *ssd1306_model_ram(const ssd1306_model_t *oled);
+// Grava a GDDRAM como imagem PBM 128x64
+bool ssd1306_model_dump_pbm(const ssd1306_model_t *oled, const char *path);
@@ -0,0 +1,304 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "devices.h"
+
+// MPU6050 com o relógio de amostragem derivado do tempo virtual. A FIFO e
+// INT_STATUS são atualizados sob demanda (a cada acesso I2C) a partir do
+// número de amostras desde o último acesso; só os pulsos de DATA_RDY no
+// pino INT usam eventos.
+
+#define REG_SMPLRT_DIV   0x19
+#define REG_CONFIG       0x1A
+#define REG_FIFO_EN      0x23
+#define REG_INT_PIN_CFG  0x37
+#define REG_INT_ENABLE   0x38
+#define REG_INT_STATUS   0x3A
+#define REG_ACCEL_XOUT_H 0x3B
+#define REG_USER_CTRL    0x6A
+#define REG_PWR_MGMT_1   0x6B
+#define REG_FIFO_COUNTH  0x72
+#define REG_FIFO_COUNTL  0x73
+#define REG_FIFO_R_W     0x74
+#define REG_WHO_AM_I     0x75
+
+#define USER_CTRL_FIFO_EN  0x40
+#define USER_CTRL_FIFO_RST 0x04
+#define PWR_SLEEP          0x40
+#define INT_DATA_RDY       0x01
+#define INT_FIFO_OFLOW     0x10
+#define INT_PIN_LATCH      0x20
+
+#define FIFO_SIZE   1024
+#define FRAME_SIZE  12     // Accel e giroscópio (FIFO_EN = 0x78)
+#define INT_PULSE_NS (50 * SIM_NS_PER_US)
+
+// Viés de fábrica que a calibração do firmware deve remover
+static const int16_t accel_bias[3] = { 312, -188, 410 };
+static const int16_t gyro_bias[3] = { -41, 27, 9 };
+
+struct mpu6050_model {
+    uint8_t regs[128];
+    uint8_t ptr;
+    bool first_write;     // Próximo byte escrito é o endereço do registrador
+    uint8_t latched[14];  // Registradores de dados congelados no START
+    int amplitude;
+    unsigned int_gpio;
+    int int_event;
+    bool int_high;
+
+    uint64_t epoch_ns;    // Instante da amostra 0 (saída do modo sleep)
+    uint64_t last_sample; // Amostras já contabilizadas na FIFO/INT_STATUS
+    uint8_t fifo[FIFO_SIZE];
+    uint32_t fifo_head, fifo_len;
+    mpu6050_model_stats_t stats;
+};
+
+static bool mpu_awake(const mpu6050_model_t *m) {
+    return !(m->regs[REG_PWR_MGMT_1] & PWR_SLEEP);
+}
+
+// Com o DLPF ativo (CONFIG != 0) a base é 1 kHz; sem ele, 8 kHz
+static uint64_t mpu_period_ns(const mpu6050_model_t *m) {
+    uint32_t base = (m->regs[REG_CONFIG] & 7) ? 1000 : 8000;
+    return SIM_NS_PER_S * (m->regs[REG_SMPLRT_DIV] + 1u) / base;
+}
+
+static uint64_t mpu_samples_at(const mpu6050_model_t *m, uint64_t t) {
+    if (!mpu_awake(m) || t < m->epoch_ns) return 0;
+    return (t - m->epoch_ns) / mpu_period_ns(m) + 1;
+}
+
+// Ruído determinístico: a amostra k tem sempre o mesmo valor
+static int mpu_noise(uint64_t k, int axis) {
+    uint64_t x = k * 6364136223846793005ull + (uint64_t)axis * 1442695040888963407ull;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 29;
+    return (int)(x % 17) - 8;
+}
+
+static int16_t mpu_clamp(long v) {
+    return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+// Amostra k (a partir de 1) em big-endian: accel xyz, temperatura, giro xyz
+static void mpu_sample(const mpu6050_model_t *m, uint64_t k, uint8_t out[14]) {
+    double t = (double)(k * mpu_period_ns(m)) / SIM_NS_PER_S;
+    int16_t v[7];
+    for (int i = 0; i < 3; i++) {
+        double phase = 2 * M_PI * (0.5 + 0.3 * i) * t;
+        long accel = accel_bias[i] + (i == 2 ? 16384 : 0) + mpu_noise(k, i);
+        long gyro = gyro_bias[i] + mpu_noise(k, i + 3);
+        accel += (long)(m->amplitude * sin(phase));
+        gyro += (long)(m->amplitude / 4 * cos(phase));
+        v[i] = mpu_clamp(accel);
+        v[4 + i] = mpu_clamp(gyro);
+    }
+    v[3] = (int16_t)((25.0 - 36.53) * 340);  // 25 °C
+    for (int i = 0; i < 7; i++) {
+        out[2 * i] = (uint8_t)((uint16_t)v[i] >> 8);
+        out[2 * i + 1] = (uint8_t)v[i];
+    }
+}
+
+static void mpu_fifo_push(mpu6050_model_t *m, const uint8_t *p, int len) {
+    for (int i = 0; i < len; i++) {
+        if (m->fifo_len == FIFO_SIZE) {
+            // Cheia: descarta o byte mais antigo, como o sensor
+            m->fifo_head = (m->fifo_head + 1) % FIFO_SIZE;
+            m->fifo_len--;
+        }
+        m->fifo[(m->fifo_head + m->fifo_len++) % FIFO_SIZE] = p[i];
+    }
+}
+
+// Contabiliza as amostras geradas desde o último acesso
+static void mpu_advance(mpu6050_model_t *m, uint64_t t) {
+    uint64_t now = mpu_samples_at(m, t);
+    if (now <= m->last_sample) return;
+    bool fifo_on = (m->regs[REG_USER_CTRL] & USER_CTRL_FIFO_EN) && m->regs[REG_FIFO_EN];
+    if (fifo_on) {
+        // Só as últimas amostras que cabem na FIFO precisam ser geradas
+        uint64_t first = m->last_sample + 1;
+        uint64_t keep = FIFO_SIZE / FRAME_SIZE + 1;
+        if (now - first + 1 > keep) first = now - keep + 1;
+        uint64_t total = now - m->last_sample;
+        if (m->fifo_len + total * FRAME_SIZE > FIFO_SIZE) {
+            uint64_t lost = (m->fifo_len + total * FRAME_SIZE - FIFO_SIZE + FRAME_SIZE - 1) / FRAME_SIZE;
+            m->stats.overflows += (uint32_t)lost;
+            m->regs[REG_INT_STATUS] |= INT_FIFO_OFLOW;
+        }
+        for (uint64_t k = first; k <= now; k++) {
+            uint8_t s[14];
+            mpu_sample(m, k, s);
+            mpu_fifo_push(m, s, 6);
+            mpu_fifo_push(m, s + 8, 6);
+        }
+        m->stats.frames += (uint32_t)total;
+    }
+    m->regs[REG_INT_STATUS] |= INT_DATA_RDY;
+    m->last_sample = now;
+}
+
+static void mpu_fifo_reset(mpu6050_model_t *m) {
+    m->fifo_head = m->fifo_len = 0;
+}
+
+static uint64_t mpu_int_event(void *ctx, uint64_t when);
+
+// Pulsos de DATA_RDY enquanto a interrupção estiver habilitada; a grade
+// é refeita a cada mudança de período, sleep ou INT_ENABLE
+static void mpu_update_int(mpu6050_model_t *m) {
+    if (m->int_event) {
+        sim_event_cancel(m->int_event);
+        m->int_event = 0;
+    }
+    if (m->int_high) {
+        m->int_high = false;
+        sim_gpio_drive(m->int_gpio, false);
+    }
+    if (!(m->regs[REG_INT_ENABLE] & INT_DATA_RDY) || !mpu_awake(m)) return;
+    uint64_t next = m->epoch_ns + mpu_samples_at(m, sim_now_ns()) * mpu_period_ns(m);
+    m->int_event = sim_event_at(next, mpu_int_event, m);
+}
+
+static uint64_t mpu_int_event(void *ctx, uint64_t when) {
+    mpu6050_model_t *m = (mpu6050_model_t *)ctx;
+    if (m->int_high) {
+        m->int_high = false;
+        sim_gpio_drive(m->int_gpio, false);
+        return m->epoch_ns + mpu_samples_at(m, when) * mpu_period_ns(m);
+    }
+    m->int_high = true;
+    m->stats.int_pulses++;
+    sim_gpio_drive(m->int_gpio, true);
+    if (m->regs[REG_INT_PIN_CFG] & INT_PIN_LATCH)
+        sim_warn("mpu6050: INT travado não é simulado; gerando pulso de 50 us");
+    return when + INT_PULSE_NS;
+}
+
+static void mpu_write_reg(mpu6050_model_t *m, uint8_t reg, uint8_t value) {
+    uint64_t t = sim_now_ns();
+    mpu_advance(m, t);
+    switch (reg) {
+        case REG_PWR_MGMT_1:
+            if (value & 0x80) {  // DEVICE_RESET
+                memset(m->regs, 0, sizeof(m->regs));
+                m->regs[REG_PWR_MGMT_1] = PWR_SLEEP;
+                m->regs[REG_WHO_AM_I] = 0x68;
+                mpu_fifo_reset(m);
+                break;
+            }
+            if (!mpu_awake(m) && !(value & PWR_SLEEP)) {
+                m->epoch_ns = t;
+                m->last_sample = 0;
+            }
+            m->regs[reg] = value;
+            break;
+        case REG_SMPLRT_DIV:
+        case REG_CONFIG:
+            // Reinicia a grade de amostragem no novo período
+            m->regs[reg] = value;
+            m->epoch_ns = t;
+            m->last_sample = 0;
+            break;
+        case REG_USER_CTRL:
+            if (value & USER_CTRL_FIFO_RST) mpu_fifo_reset(m);
+            m->regs[reg] = value & ~USER_CTRL_FIFO_RST;
+            break;
+        case REG_INT_STATUS:
+        case REG_WHO_AM_I:
+        case REG_FIFO_COUNTH:
+        case REG_FIFO_COUNTL:
+            break;  // Somente leitura
+        case REG_FIFO_R_W:
+            mpu_fifo_push(m, &value, 1);
+            break;
+        default:
+            m->regs[reg] = value;
+            break;
+    }
+    if (reg == REG_INT_ENABLE || reg == REG_PWR_MGMT_1 || reg == REG_SMPLRT_DIV || reg == REG_CONFIG)
+        mpu_update_int(m);
+}
+
+static uint8_t mpu_read_reg(mpu6050_model_t *m, uint8_t reg) {
+    switch (reg) {
+        case REG_INT_STATUS: {
+            uint8_t v = m->regs[reg];
+            m->regs[reg] = 0;  // Limpo na leitura
+            return v;
+        }
+        case REG_FIFO_COUNTH:
+            return (uint8_t)(m->fifo_len >> 8);
+        case REG_FIFO_COUNTL:
+            return (uint8_t)m->fifo_len;
+        case REG_FIFO_R_W: {
+            if (!m->fifo_len) return 0xFF;
+            uint8_t v = m->fifo[m->fifo_head];
+            m->fifo_head = (m->fifo_head + 1) % FIFO_SIZE;
+            m->fifo_len--;
+            return v;
+        }
+        default:
+            if (reg >= REG_ACCEL_XOUT_H && reg < REG_ACCEL_XOUT_H + 14)
+                return m->latched[reg - REG_ACCEL_XOUT_H];
+            return m->regs[reg & 0x7F];
+    }
+}
+
+static bool mpu_start(void *dev, bool read) {
+    mpu6050_model_t *m = (mpu6050_model_t *)dev;
+    m->first_write = !read;
+    if (read) {
+        // Os registradores de dados são lidos de um registrador-sombra estável
+        mpu_advance(m, sim_now_ns());
+        uint64_t k = mpu_samples_at(m, sim_now_ns());
+        if (k) mpu_sample(m, k, m->latched);
+        else memset(m->latched, 0, sizeof(m->latched));
+    }
+    return true;
+}
+
+static void mpu_write(void *dev, uint8_t byte) {
+    mpu6050_model_t *m = (mpu6050_model_t *)dev;
+    if (m->first_write) {
+        m->ptr = byte & 0x7F;
+        m->first_write = false;
+        return;
+    }
+    mpu_write_reg(m, m->ptr, byte);
+    if (m->ptr != REG_FIFO_R_W) m->ptr = (m->ptr + 1) & 0x7F;
+}
+
+static uint8_t mpu_read(void *dev) {
+    mpu6050_model_t *m = (mpu6050_model_t *)dev;
+    uint8_t v = mpu_read_reg(m, m->ptr);
+    if (m->ptr != REG_FIFO_R_W) m->ptr = (m->ptr + 1) & 0x7F;
+    return v;
+}
+
+static void mpu_stop(void *dev) {
+    (void)dev;
+}
+
+static const sim_i2c_ops_t mpu_ops = { mpu_start, mpu_write, mpu_read, mpu_stop };
+
+mpu6050_model_t *mpu6050_model_create(unsigned i2c_bus, uint8_t addr, unsigned int_gpio) {
+    mpu6050_model_t *m = calloc(1, sizeof(*m));
+    m->regs[REG_PWR_MGMT_1] = PWR_SLEEP;
+    m->regs[REG_WHO_AM_I] = 0x68;
+    m->int_gpio = int_gpio;
+    sim_i2c_attach(i2c_bus, addr, &mpu_ops, m);
+    return m;
+}
+
+void mpu6050_model_set_motion(mpu6050_model_t *mpu, int amplitude) {
+    mpu->amplitude = amplitude;
+}
+
+void mpu6050_model_get_stats(const mpu6050_model_t *mpu, mpu6050_model_stats_t *stats) {
+    *stats = mpu->stats;
+}
@@ -0,0 +1,375 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+#include "devices.h"
+
+// Cartão SDHC em modo SPI: comandos com CRC7, blocos de dados com CRC16,
+// escrita simples e múltipla (tokens 0xFE/0xFC/0xFD) e leitura simples e
+// múltipla. Só responde com CS em nível baixo.
+
+#define SD_BLOCK 512
+#define SD_OUT_LEN (SD_BLOCK + 8)
+#define SD_INIT_ATTEMPTS 3  // ACMD41 até sair do estado idle
+
+#define R1_IDLE    0x01
+#define R1_ILLEGAL 0x04
+#define R1_CRC     0x08
+#define R1_ADDRESS 0x20
+#define R1_PARAM   0x40
+
+typedef enum {
+    SD_IDLE,         // Esperando comando
+    SD_WRITE_TOKEN,  // CMD24/CMD25: esperando o token de dados
+    SD_WRITE_DATA,   // Recebendo bloco + CRC
+    SD_READ          // CMD17/CMD18: blocos saindo
+} sd_state_t;
+
+struct sd_model {
+    int fd;
+    uint64_t blocks;
+    sd_model_timing_t timing;
+    sd_model_stats_t stats;
+    unsigned cs_gpio;
+    bool selected;
+
+    // Estado do protocolo
+    sd_state_t state;
+    bool idle;             // Bit idle do R1 (antes do ACMD41 concluir)
+    bool app_cmd;          // Próximo comando é ACMD
+    bool crc_on;
+    int init_attempts;
+    uint8_t cmd[6];
+    int cmd_len;
+    bool multi;
+    uint64_t addr;         // Próximo bloco
+    uint8_t data[SD_BLOCK + 2];
+    int data_len;
+    uint64_t read_ready_ns;
+
+    // Bytes a enviar pelo MISO; quando a fila esvazia começa o ocupado
+    uint8_t out[SD_OUT_LEN];
+    int out_head, out_len;
+    uint64_t pending_busy_ns;
+    uint64_t busy_until_ns;
+};
+
+static uint8_t sd_crc7(const uint8_t *p, int len) {
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++) {
+        uint8_t b = p[i];
+        for (int j = 0; j < 8; j++) {
+            crc <<= 1;
+            if ((b ^ crc) & 0x80) crc ^= 0x09;
+            b <<= 1;
+        }
+    }
+    return crc & 0x7F;
+}
+
+// CRC-16-CCITT (XMODEM) bit a bit, independente das tabelas do firmware
+static uint16_t sd_crc16(const uint8_t *p, int len) {
+    uint16_t crc = 0;
+    for (int i = 0; i < len; i++) {
+        crc ^= (uint16_t)(p[i] << 8);
+        for (int j = 0; j < 8; j++) crc = (crc & 0x8000) ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static void sd_out(sd_model_t *sd, uint8_t b) {
+    if (sd->out_len == SD_OUT_LEN) sim_fatal("sd: fila de saída cheia");
+    sd->out[(sd->out_head + sd->out_len++) % SD_OUT_LEN] = b;
+}
+
+static uint8_t sd_r1(const sd_model_t *sd, uint8_t flags) {
+    return flags | (sd->idle ? R1_IDLE : 0);
+}
+
+// Seta os bits [msb:lsb] do registrador de 16 bytes, na numeração do CSD
+static void sd_set_bits(uint8_t *reg, int msb, int lsb, uint32_t value) {
+    for (int p = lsb; p <= msb; p++) {
+        uint8_t *byte = &reg[15 - p / 8];
+        if (value & (1u << (p - lsb))) *byte |= (uint8_t)(1u << (p % 8));
+        else *byte &= (uint8_t)~(1u << (p % 8));
+    }
+}
+
+static void sd_out_register(sd_model_t *sd, uint8_t *reg) {
+    reg[15] = (uint8_t)(sd_crc7(reg, 15) << 1 | 1);
+    uint16_t crc = sd_crc16(reg, 16);
+    sd_out(sd, 0xFF);
+    sd_out(sd, 0xFE);
+    for (int i = 0; i < 16; i++) sd_out(sd, reg[i]);
+    sd_out(sd, (uint8_t)(crc >> 8));
+    sd_out(sd, (uint8_t)crc);
+}
+
+static void sd_out_csd(sd_model_t *sd) {
+    uint8_t csd[16] = { 0 };
+    sd_set_bits(csd, 127, 126, 1);                                // CSD versão 2.0
+    sd_set_bits(csd, 103, 96, 0x32);                              // TRAN_SPEED 25 MHz
+    sd_set_bits(csd, 95, 84, 0x5B5);                              // CCC
+    sd_set_bits(csd, 83, 80, 9);                                  // READ_BL_LEN 512
+    sd_set_bits(csd, 69, 48, (uint32_t)(sd->blocks / 1024 - 1));  // C_SIZE
+    sd_set_bits(csd, 25, 22, 9);                                  // WRITE_BL_LEN 512
+    sd_out_register(sd, csd);
+}
+
+static void sd_out_cid(sd_model_t *sd) {
+    uint8_t cid[16] = { 0x03, 'S', 'D', 'S', 'I', 'M', 'U', 'L', 0x10, 0, 0, 0, 1, 0x01, 0x9A, 0 };
+    sd_out_register(sd, cid);
+}
+
+static bool sd_address(sd_model_t *sd, uint32_t arg) {
+    sd->addr = arg;  // SDHC: endereço em blocos
+    return sd->addr < sd->blocks;
+}
+
+static void sd_command(sd_model_t *sd, uint64_t t) {
+    uint8_t index = sd->cmd[0] & 0x3F;
+    uint32_t arg = (uint32_t)sd->cmd[1] << 24 | sd->cmd[2] << 16 | sd->cmd[3] << 8 | sd->cmd[4];
+    bool acmd = sd->app_cmd;
+    sd->app_cmd = false;
+    sd->stats.cmds++;
+
+    // O cartão para de transmitir ao receber um comando
+    sd->out_len = 0;
+    if (sd->state == SD_READ) sd->state = SD_IDLE;
+
+    sd_out(sd, 0xFF);  // NCR
+    if ((sd->crc_on || index == 0 || index == 8) && (sd->cmd[5] | 1) != (sd_crc7(sd->cmd, 5) << 1 | 1)) {
+        sd->stats.crc_errors++;
+        sd_out(sd, sd_r1(sd, R1_CRC));
+        return;
+    }
+
+    switch (acmd ? 100 + index : index) {
+        case 0:
+            sd->state = SD_IDLE;
+            sd->idle = true;
+            sd->crc_on = false;
+            sd->init_attempts = 0;
+            sd_out(sd, R1_IDLE);
+            break;
+        case 8:
+            sd_out(sd, sd_r1(sd, 0));
+            sd_out(sd, 0x00);
+            sd_out(sd, 0x00);
+            sd_out(sd, (uint8_t)((arg >> 8) & 0x0F));
+            sd_out(sd, (uint8_t)arg);
+            break;
+        case 9:
+            sd_out(sd, sd_r1(sd, 0));
+            sd_out_csd(sd);
+            break;
+        case 10:
+            sd_out(sd, sd_r1(sd, 0));
+            sd_out_cid(sd);
+            break;
+        case 12:
+            sd_out(sd, 0xFF);  // Byte de enchimento após o CMD12
+            sd_out(sd, sd_r1(sd, 0));
+            break;
+        case 13:
+            sd_out(sd, sd_r1(sd, 0));
+            sd_out(sd, 0x00);
+            break;
+        case 16:
+            sd_out(sd, sd_r1(sd, arg == SD_BLOCK ? 0 : R1_PARAM));
+            break;
+        case 17:
+        case 18:
+            if (sd->idle || !sd_address(sd, arg)) {
+                sd_out(sd, sd_r1(sd, sd->idle ? R1_ILLEGAL : R1_ADDRESS));
+                break;
+            }
+            sd_out(sd, 0x00);
+            sd->state = SD_READ;
+            sd->multi = index == 18;
+            sd->read_ready_ns = t + (uint64_t)sd->timing.read_us * SIM_NS_PER_US;
+            break;
+        case 24:
+        case 25:
+            if (sd->idle || !sd_address(sd, arg)) {
+                sd_out(sd, sd_r1(sd, sd->idle ? R1_ILLEGAL : R1_ADDRESS));
+                break;
+            }
+            sd_out(sd, 0x00);
+            sd->state = SD_WRITE_TOKEN;
+            sd->multi = index == 25;
+            break;
+        case 55:
+            sd->app_cmd = true;
+            sd_out(sd, sd_r1(sd, 0));
+            break;
+        case 58: {
+            uint32_t ocr = 0x00FF8000u;  // 2,7-3,6 V
+            if (!sd->idle) ocr |= 0x80000000u | 0x40000000u;  // Ligado, CCS
+            sd_out(sd, sd_r1(sd, 0));
+            for (int i = 3; i >= 0; i--) sd_out(sd, (uint8_t)(ocr >> (8 * i)));
+            break;
+        }
+        case 59:
+            sd->crc_on = arg & 1;
+            sd_out(sd, sd_r1(sd, 0));
+            break;
+        case 100 + 23:
+            sd_out(sd, sd_r1(sd, 0));
+            break;
+        case 100 + 41:
+            if (++sd->init_attempts >= SD_INIT_ATTEMPTS) sd->idle = false;
+            sd_out(sd, sd_r1(sd, 0));
+            break;
+        default:
+            sd_out(sd, sd_r1(sd, R1_ILLEGAL));
+            break;
+    }
+}
+
+static void sd_read_next(sd_model_t *sd) {
+    uint8_t block[SD_BLOCK];
+    if (pread(sd->fd, block, SD_BLOCK, (off_t)(sd->addr * SD_BLOCK)) != SD_BLOCK)
+        sim_fatal("sd: falha lendo o bloco %llu da imagem", (unsigned long long)sd->addr);
+    uint16_t crc = sd_crc16(block, SD_BLOCK);
+    sd_out(sd, 0xFE);
+    for (int i = 0; i < SD_BLOCK; i++) sd_out(sd, block[i]);
+    sd_out(sd, (uint8_t)(crc >> 8));
+    sd_out(sd, (uint8_t)crc);
+    sd->stats.blocks_read++;
+    sd->addr++;
+    if (!sd->multi || sd->addr >= sd->blocks) sd->state = SD_IDLE;
+}
+
+static void sd_write_done(sd_model_t *sd) {
+    uint16_t crc = (uint16_t)(sd->data[SD_BLOCK] << 8 | sd->data[SD_BLOCK + 1]);
+    if (sd->crc_on && crc != sd_crc16(sd->data, SD_BLOCK)) {
+        sd->stats.crc_errors++;
+        sd_out(sd, 0xEB);  // CRC rejeitado
+        sd->state = sd->multi ? SD_WRITE_TOKEN : SD_IDLE;
+        return;
+    }
+    if (pwrite(sd->fd, sd->data, SD_BLOCK, (off_t)(sd->addr * SD_BLOCK)) != SD_BLOCK)
+        sim_fatal("sd: falha gravando o bloco %llu da imagem", (unsigned long long)sd->addr);
+    sd->stats.blocks_written++;
+    uint64_t busy = sd->multi ? sd->timing.block_write_us : sd->timing.single_write_us;
+    if (sd->timing.stall_every && sd->stats.blocks_written % sd->timing.stall_every == 0) {
+        busy += sd->timing.stall_us;
+        sd->stats.stalls++;
+    }
+    sd_out(sd, 0xE5);  // Dados aceitos
+    sd->pending_busy_ns = busy * SIM_NS_PER_US;
+    sd->addr++;
+    sd->state = sd->multi && sd->addr < sd->blocks ? SD_WRITE_TOKEN : SD_IDLE;
+}
+
+static void sd_receive(sd_model_t *sd, uint8_t mosi, uint64_t t) {
+    if (sd->cmd_len) {
+        sd->cmd[sd->cmd_len++] = mosi;
+        if (sd->cmd_len == 6) {
+            sd->cmd_len = 0;
+            sd_command(sd, t);
+        }
+        return;
+    }
+    switch (sd->state) {
+        case SD_WRITE_TOKEN:
+            if (mosi == (sd->multi ? 0xFC : 0xFE)) {
+                sd->state = SD_WRITE_DATA;
+                sd->data_len = 0;
+            } else if (sd->multi && mosi == 0xFD) {
+                sd->state = SD_IDLE;
+                sd_out(sd, 0xFF);  // Nbr: o ocupado começa um byte depois
+                sd->pending_busy_ns = (uint64_t)sd->timing.stop_us * SIM_NS_PER_US;
+            }
+            return;
+        case SD_WRITE_DATA:
+            sd->data[sd->data_len++] = mosi;
+            if (sd->data_len == SD_BLOCK + 2) sd_write_done(sd);
+            return;
+        default:
+            if ((mosi & 0xC0) == 0x40 && t >= sd->busy_until_ns) {
+                sd->cmd[0] = mosi;
+                sd->cmd_len = 1;
+            }
+            return;
+    }
+}
+
+static uint8_t sd_transmit(sd_model_t *sd, uint64_t t) {
+    if (sd->out_len) {
+        uint8_t b = sd->out[sd->out_head];
+        sd->out_head = (sd->out_head + 1) % SD_OUT_LEN;
+        sd->out_len--;
+        return b;
+    }
+    if (sd->pending_busy_ns) {
+        sd->busy_until_ns = t + sd->pending_busy_ns;
+        sd->stats.busy_ns += sd->pending_busy_ns;
+        sd->pending_busy_ns = 0;
+    }
+    if (t < sd->busy_until_ns) return 0x00;
+    if (sd->state == SD_READ && t >= sd->read_ready_ns) {
+        sd_read_next(sd);
+        sd->read_ready_ns = t + (uint64_t)sd->timing.read_us * SIM_NS_PER_US;
+    }
+    return 0xFF;
+}
+
+// Full-duplex: o byte que sai foi decidido antes do byte que entra
+static uint8_t sd_xfer(void *dev, uint8_t mosi, uint64_t t_ns) {
+    sd_model_t *sd = (sd_model_t *)dev;
+    if (!sd->selected) return 0xFF;
+    uint8_t miso = sd_transmit(sd, t_ns);
+    sd_receive(sd, mosi, t_ns);
+    return miso;
+}
+
+static void sd_cs(void *dev, unsigned gpio, bool level) {
+    (void)gpio;
+    sd_model_t *sd = (sd_model_t *)dev;
+    sd->selected = !level;
+    if (level) sd->cmd_len = 0;
+}
+
+sd_model_t *sd_model_open(const char *path, uint64_t size_bytes, const sd_model_timing_t *timing) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size == 0 && size_bytes) {
+        if (ftruncate(fd, (off_t)size_bytes) != 0) {
+            close(fd);
+            return NULL;
+        }
+        size = (off_t)size_bytes;
+    }
+    // C_SIZE conta unidades de 512 KB
+    if (size < 1024 * SD_BLOCK || size % (1024 * SD_BLOCK)) {
+        close(fd);
+        return NULL;
+    }
+    sd_model_t *sd = calloc(1, sizeof(*sd));
+    sd->fd = fd;
+    sd->blocks = (uint64_t)size / SD_BLOCK;
+    sd->timing = *timing;
+    sd->idle = true;
+    return sd;
+}
+
+void sd_model_attach(sd_model_t *sd, unsigned spi_bus, unsigned cs_gpio) {
+    sd->cs_gpio = cs_gpio;
+    sim_spi_attach(spi_bus, sd_xfer, sd);
+    sim_gpio_watch(cs_gpio, sd_cs, sd);
+}
+
+void sd_model_get_stats(const sd_model_t *sd, sd_model_stats_t *stats) {
+    *stats = sd->stats;
+}
+
+void sd_model_close(sd_model_t *sd) {
+    fsync(sd->fd);
+    close(sd->fd);
+    free(sd);
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "devices.h"
+
+// SSD1306 128x64: byte de controle (Co, D/C#), comandos com argumentos e
+// os três modos de endereçamento da GDDRAM
+
+#define OLED_W 128
+#define OLED_PAGES 8
+
+struct ssd1306_model {
+    uint8_t ram[OLED_PAGES][OLED_W];
+    bool expect_control;  // Próximo byte é um byte de controle
+    bool continuation;    // Co = 0: o resto da transação é do mesmo tipo
+    bool data;            // D/C#
+    // Comando em montagem (persiste entre transações)
+    uint8_t cmd[8];
+    int cmd_len, cmd_need;
+    uint8_t mode;         // 0 horizontal, 1 vertical, 2 página
+    uint8_t col, col_start, col_end;
+    uint8_t page, page_start, page_end;
+    ssd1306_model_stats_t stats;
+};
+
+// Bytes de argumento de cada comando
+static int oled_args(uint8_t c) {
+    switch (c) {
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3: case 0xD5:
+        case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        case 0x21: case 0x22: case 0xA3:
+            return 2;
+        case 0x29: case 0x2A:
+            return 5;
+        case 0x26: case 0x27:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+static void oled_command(ssd1306_model_t *o) {
+    uint8_t c = o->cmd[0];
+    o->stats.commands++;
+    switch (c) {
+        case 0x20:
+            o->mode = o->cmd[1] & 3;
+            break;
+        case 0x21:
+            o->col = o->col_start = o->cmd[1] & 0x7F;
+            o->col_end = o->cmd[2] & 0x7F;
+            break;
+        case 0x22:
+            o->page = o->page_start = o->cmd[1] & 7;
+            o->page_end = o->cmd[2] & 7;
+            break;
+        default:
+            if (o->mode == 2 && c >= 0xB0 && c <= 0xB7) o->page = c & 7;
+            else if (o->mode == 2 && c <= 0x0F) o->col = (o->col & 0xF0) | c;
+            else if (o->mode == 2 && c >= 0x10 && c <= 0x1F) o->col = (uint8_t)((o->col & 0x0F) | (c & 0x0F) << 4);
+            break;
+    }
+}
+
+static void oled_data(ssd1306_model_t *o, uint8_t b) {
+    o->ram[o->page][o->col] = b;
+    o->stats.data_bytes++;
+    switch (o->mode) {
+        case 0:
+            if (o->col++ >= o->col_end) {
+                o->col = o->col_start;
+                o->page = o->page >= o->page_end ? o->page_start : o->page + 1;
+            }
+            break;
+        case 1:
+            if (o->page++ >= o->page_end) {
+                o->page = o->page_start;
+                o->col = o->col >= o->col_end ? o->col_start : o->col + 1;
+            }
+            break;
+        default:
+            o->col = (o->col + 1) % OLED_W;
+            break;
+    }
+}
+
+static bool oled_start(void *dev, bool read) {
+    ssd1306_model_t *o = (ssd1306_model_t *)dev;
+    if (read) return false;  // Somente escrita no I2C
+    o->expect_control = true;
+    o->continuation = false;
+    o->stats.transactions++;
+    return true;
+}
+
+static void oled_write(void *dev, uint8_t b) {
+    ssd1306_model_t *o = (ssd1306_model_t *)dev;
+    if (o->expect_control) {
+        o->data = b & 0x40;
+        o->continuation = !(b & 0x80);
+        o->expect_control = false;
+        return;
+    }
+    if (!o->continuation) o->expect_control = true;
+    if (o->data) {
+        oled_data(o, b);
+        return;
+    }
+    if (!o->cmd_len) o->cmd_need = 1 + oled_args(b);
+    o->cmd[o->cmd_len++] = b;
+    if (o->cmd_len == o->cmd_need) {
+        oled_command(o);
+        o->cmd_len = 0;
+    }
+}
+
+static uint8_t oled_read(void *dev) {
+    (void)dev;
+    return 0xFF;
+}
+
+static void oled_stop(void *dev) {
+    (void)dev;
+}
+
+static const sim_i2c_ops_t oled_ops = { oled_start, oled_write, oled_read, oled_stop };
+
+ssd1306_model_t *ssd1306_model_create(unsigned i2c_bus, uint8_t addr) {
+    ssd1306_model_t *o = calloc(1, sizeof(*o));
+    o->mode = 2;  // Valor de reset
+    o->col_end = OLED_W - 1;
+    o->page_end = OLED_PAGES - 1;
+    sim_i2c_attach(i2c_bus, addr, &oled_ops, o);
+    return o;
+}
+
+void ssd1306_model_get_stats(const ssd1306_model_t *oled, ssd1306_model_stats_t *stats) {
+    *stats = oled->stats;
+}
+
+const uint8_t *ssd1306_model_ram(const ssd1306_model_t *oled) {
+    return &oled->ram[0][0];
+}
+
+bool ssd1306_model_dump_pbm(const ssd1306_model_t *oled, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "P1\n%d %d\n", OLED_W, OLED_PAGES * 8);
+    for (int y = 0; y < OLED_PAGES * 8; y++) {
+        for (int x = 0; x < OLED_W; x++)
+            fputs((oled->ram[y / 8][x] >> (y % 8)) & 1 ? "1" : "0", f);
+        fputc('\n', f);
+    }
+    return fclose(f) == 0;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "pico/types.h"
+
+#define NUM_DMA_CHANNELS 12
+
+// Só os registradores de IRQ e do sniffer são lidos pelo firmware; o
+// estado dos canais fica no simulador (os endereços não cabem em 32 bits).
+typedef struct {
+    io_rw_32 intr;
+    io_rw_32 inte0;
+    io_rw_32 intf0;
+    io_rw_32 ints0;
+    uint32_t _pad0;
+    io_rw_32 inte1;
+    io_rw_32 intf1;
+    io_rw_32 ints1;
+    io_rw_32 sniff_ctrl;
+    io_rw_32 sniff_data;
+} dma_hw_t;
+
+extern dma_hw_t *dma_hw;
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+#define DREQ_I2C0_TX 32
+#define DREQ_I2C0_RX 33
+#define DREQ_I2C1_TX 34
+#define DREQ_I2C1_RX 35
+#define DREQ_FORCE   0x3f
+
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC32   0x0
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC32R  0x1
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC16   0x2
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC16R  0x3
+#define DMA_SNIFF_CTRL_CALC_VALUE_EVEN    0xe
+#define DMA_SNIFF_CTRL_CALC_VALUE_SUM     0xf
+
+// Mesmo layout de CTRL do RP2040
+#define DMA_CH0_CTRL_TRIG_EN_BITS          0x00000001u
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB    2
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS   0x0000000cu
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS   0x00000010u
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS  0x00000020u
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB     15
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS    0x001f8000u
+#define DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS    0x00800000u
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | DMA_CH0_CTRL_TRIG_INCR_READ_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_READ_BITS;
+}
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS;
+}
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) | (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) | ((uint)size << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+static inline void channel_config_set_sniff_enable(dma_channel_config *c, bool sniff) {
+    c->ctrl = sniff ? c->ctrl | DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS;
+}
+static inline void channel_config_set_enable(dma_channel_config *c, bool enable) {
+    c->ctrl = enable ? c->ctrl | DMA_CH0_CTRL_TRIG_EN_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_EN_BITS;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+void dma_channel_claim(uint channel);
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+bool dma_channel_is_claimed(uint channel);
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_start_channel_mask(uint32_t chan_mask);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+void dma_channel_abort(uint channel);
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+static inline bool dma_channel_get_irq0_status(uint channel) { return dma_hw->ints0 & (1u << channel); }
+static inline bool dma_channel_get_irq1_status(uint channel) { return dma_hw->ints1 & (1u << channel); }
+static inline void dma_channel_acknowledge_irq0(uint channel) { dma_hw->ints0 &= ~(1u << channel); }
+static inline void dma_channel_acknowledge_irq1(uint channel) { dma_hw->ints1 &= ~(1u << channel); }
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable);
+void dma_sniffer_disable(void);
+static inline void dma_sniffer_set_data_accumulator(uint32_t seed_value) { dma_hw->sniff_data = seed_value; }
+static inline uint32_t dma_sniffer_get_data_accumulator(void) { return dma_hw->sniff_data; }
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pico/types.h"
+
+// Flash de 2 MB da Pico W. No host o XIP aponta para a cópia simulada em
+// sim_periph.c: o firmware lê a flash pelo mesmo endereço mapeado.
+#define FLASH_PAGE_SIZE       (1u << 8)
+#define FLASH_SECTOR_SIZE     (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+extern uint8_t sim_flash_xip[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)sim_flash_xip)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pico/types.h"
+
+typedef void (*irq_handler_t)(void);
+
+enum irq_num_rp2040 {
+    TIMER_IRQ_0 = 0,
+    DMA_IRQ_0 = 11,
+    DMA_IRQ_1 = 12,
+    I2C0_IRQ = 23,
+    I2C1_IRQ = 24,
+    NUM_IRQS = 32
+};
+
+void irq_set_enabled(uint num, bool enabled);
+bool irq_is_enabled(uint num);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint num, irq_handler_t handler);
+void irq_set_priority(uint num, uint8_t hardware_priority);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "pico/util/datetime.h"
+
+void rtc_init(void);
+bool rtc_set_datetime(const datetime_t *t);
+bool rtc_get_datetime(datetime_t *t);
+bool rtc_running(void);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "pico/types.h"
+
+typedef struct {
+    io_rw_32 cr0;
+    io_rw_32 cr1;
+    io_rw_32 dr;
+    io_ro_32 sr;
+    io_rw_32 cpsr;
+    io_rw_32 imsc;
+    io_ro_32 ris;
+    io_ro_32 mis;
+    io_wo_32 icr;
+    io_rw_32 dmacr;
+} spi_hw_t;
+
+// Cada instância aponta para os registradores simulados do controlador
+typedef struct spi_inst spi_inst_t;
+extern spi_hw_t sim_spi_hw[2];
+#define spi0 ((spi_inst_t *)&sim_spi_hw[0])
+#define spi1 ((spi_inst_t *)&sim_spi_hw[1])
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+static inline uint spi_get_index(const spi_inst_t *spi) { return spi == spi1 ? 1u : 0u; }
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return (spi_hw_t *)spi; }
+static inline const spi_hw_t *spi_get_const_hw(const spi_inst_t *spi) { return (const spi_hw_t *)spi; }
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+void spi_deinit(spi_inst_t *spi);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+uint spi_get_baudrate(const spi_inst_t *spi);
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha,
+                    spi_order_t order);
+static inline bool spi_is_writable(const spi_inst_t *spi) { (void)spi; return true; }
+static inline bool spi_is_readable(const spi_inst_t *spi) { (void)spi; return false; }
+static inline bool spi_is_busy(const spi_inst_t *spi) { (void)spi; return false; }
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pico/types.h"
+
+typedef struct {
+    io_ro_32 cpuid;
+    io_rw_32 icsr;
+    io_rw_32 vtor;
+    io_rw_32 aircr;
+    io_rw_32 scr;
+} armv6m_scb_hw_t;
+
+extern armv6m_scb_hw_t *scb_hw;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pico/types.h"
+
+typedef struct {
+    uint32_t save;
+    bool initialized;
+} critical_section_t;
+
+void critical_section_init(critical_section_t *crit_sec);
+void critical_section_enter_blocking(critical_section_t *crit_sec);
+void critical_section_exit(critical_section_t *crit_sec);
+void critical_section_deinit(critical_section_t *crit_sec);
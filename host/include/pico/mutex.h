@@ -0,0 +1,19 @@
+#pragma once
+
+#include "pico/types.h"
+#include "pico/time.h"
+
+// owner: núcleo dono + 1; 0 quando livre
+typedef struct {
+    volatile int8_t owner;
+    bool initialized;
+} mutex_t;
+
+void mutex_init(mutex_t *mtx);
+static inline bool mutex_is_initialized(mutex_t *mtx) { return mtx->initialized; }
+void mutex_enter_blocking(mutex_t *mtx);
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out);
+bool mutex_enter_timeout_ms(mutex_t *mtx, uint32_t timeout_ms);
+void mutex_exit(mutex_t *mtx);
+
+#define auto_init_mutex(name) static mutex_t name = { 0, true }
@@ -0,0 +1,17 @@
+#pragma once
+
+// No host as esperas ativas do firmware cedem a vez ao tempo virtual: sem
+// isso um laço como while (!flag) tight_loop_contents() nunca veria a IRQ.
+void sim_idle(void);
+unsigned sim_core_num(void);
+void sim_wfe(void);
+void sim_sev(void);
+
+static inline void tight_loop_contents(void) { sim_idle(); }
+static inline void __wfe(void) { sim_wfe(); }
+static inline void __wfi(void) { sim_wfe(); }
+static inline void __sev(void) { sim_sev(); }
+// Os dois núcleos rodam na mesma thread: basta uma barreira do compilador
+static inline void __dmb(void) { __asm volatile("" ::: "memory"); }
+static inline void __compiler_memory_barrier(void) { __asm volatile("" ::: "memory"); }
+static inline unsigned get_core_num(void) { return sim_core_num(); }
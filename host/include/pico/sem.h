@@ -0,0 +1,17 @@
+#pragma once
+
+#include "pico/types.h"
+#include "pico/time.h"
+
+typedef struct {
+    volatile int16_t permits;
+    int16_t max_permits;
+} semaphore_t;
+
+void sem_init(semaphore_t *sem, int16_t initial_permits, int16_t max_permits);
+int sem_available(semaphore_t *sem);
+bool sem_release(semaphore_t *sem);
+void sem_reset(semaphore_t *sem, int16_t permits);
+void sem_acquire_blocking(semaphore_t *sem);
+bool sem_acquire_timeout_ms(semaphore_t *sem, uint32_t timeout_ms);
+bool sem_acquire_timeout_us(semaphore_t *sem, uint32_t timeout_us);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdio.h>
+#include "pico/types.h"
+
+bool stdio_init_all(void);
+void stdio_flush(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+// No RP2040 long tem 32 bits e o firmware formata uint32_t com "%lu".
+// Estas versões removem o modificador 'l' (não o 'll') antes de chamar a
+// libc do host, onde long tem 64 bits.
+int sim_printf(const char *fmt, ...);
+int sim_sprintf(char *buf, const char *fmt, ...);
+int sim_snprintf(char *buf, size_t size, const char *fmt, ...);
+
+#define printf(...) sim_printf(__VA_ARGS__)
+#define sprintf(...) sim_sprintf(__VA_ARGS__)
+#define snprintf(...) sim_snprintf(__VA_ARGS__)
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "pico/types.h"
+#include "pico/time.h"
+#include "pico/stdio.h"
+#include "hardware/gpio.h"
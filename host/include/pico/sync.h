@@ -0,0 +1,6 @@
+#pragma once
+
+#include "pico/mutex.h"
+#include "pico/sem.h"
+#include "pico/critical_section.h"
+#include "hardware/sync.h"
@@ -0,0 +1,28 @@
+#pragma once
+
+// Shim do pico-sdk para o build de host (host/): só o que o firmware usa,
+// com a mesma assinatura do SDK 2.1.1. As implementações ficam em host/sim.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pico/error.h"
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define __not_in_flash_func(f) f
+#define __time_critical_func(f) f
+#define __not_in_flash(g)
+#define __scratch_x(n)
+#define __scratch_y(n)
+#define __aligned(x) __attribute__((aligned(x)))
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+
+#define PICO_DEFAULT_LED_PIN 25
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+#include "pico/platform.h"
@@ -0,0 +1,553 @@
+/*
+ * Datalogger em host: o firmware roda sem alterações sobre a simulação de
+ * host/sim, com o cartão SD num arquivo de imagem e botões e movimento do
+ * sensor vindos de um roteiro. O relógio é virtual, então horas de
+ * gravação levam segundos.
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "devices.h"
+#include "pico/stdlib.h"
+#include "ff.h"
+#include "sd_card.h"
+#include "hw_config.h"
+#include "lib/log_format.h"
+#include "lib/ssd1306.h"
+
+// main() de datalogger.c, renomeado na compilação
+int datalogger_main(void);
+extern ssd1306_t disp;
+extern i2c_dma_t oled_bus;
+
+// --- LIGAÇÕES (mesmos pinos e endereços de datalogger.c e hw_config.c) ---
+#define HOST_BUTTON_1_PIN 5
+#define HOST_BUTTON_2_PIN 6
+#define HOST_MPU_BUS      0
+#define HOST_MPU_ADDR     0x68
+#define HOST_MPU_INT_PIN  8
+#define HOST_OLED_BUS     1
+#define HOST_OLED_ADDR    0x3C
+#define HOST_SD_SPI       0
+#define HOST_SD_CS_PIN    17
+
+// --- CUSTO DE CPU ---
+// O relógio virtual só anda com esperas e periféricos. Sem isto, um
+// update_display que não tem nada a enviar custaria zero e o laço da
+// máquina de estados giraria sem o tempo avançar. Valor da ordem do
+// desenho e da comparação do quadro no RP2040 a 125 MHz.
+#define HOST_OLED_FRAME_CPU_NS (150 * SIM_NS_PER_US)
+
+bool __real_ssd1306_present(ssd1306_t *ssd);
+
+// Ligado com -Wl,--wrap=ssd1306_present (host/CMakeLists.txt)
+bool __wrap_ssd1306_present(ssd1306_t *ssd) {
+    sim_spend_ns(HOST_OLED_FRAME_CPU_NS);
+    return __real_ssd1306_present(ssd);
+}
+
+// --- ROTEIRO PADRÃO (--record) ---
+#define HOST_BOOT_MS      8000  // Inicialização e calibração já terminaram
+#define HOST_SETTLE_MS    4000  // Depois de parar: f_close e "Dados Salvos!"
+#define HOST_PRESS_MS     100
+
+typedef enum { STEP_PRESS, STEP_MOTION, STEP_EXIT } step_kind_t;
+
+typedef struct {
+    uint64_t t_ns;
+    step_kind_t kind;
+    unsigned pin;
+    uint32_t arg;  // Duração do toque em ms, ou amplitude do movimento
+} host_step_t;
+
+typedef struct {
+    const char *image;
+    uint64_t size_mb;
+    uint32_t record_s;
+    const char *script;
+    const char *oled_dump;
+    const char *flash;  // Flash persistente entre execuções (calibração e configuração)
+    uint32_t max_s;
+    bool verify;
+    bool verify_only;
+    bool failed;  // A simulação que chamou a verificação já falhou
+    sd_model_timing_t sd_timing;
+} host_options_t;
+
+static host_options_t opt = {
+    .image = "sd.img",
+    .size_mb = 1024,
+    .record_s = 10,
+    .max_s = 24 * 3600,
+    .verify = true,
+    .sd_timing = {
+        .read_us = 200,
+        .block_write_us = 300,
+        .single_write_us = 1500,
+        .stop_us = 2000,
+        .stall_every = 4096,
+        .stall_us = 100000,
+    },
+};
+
+static host_step_t *steps;
+static int n_steps;
+static sd_model_t *sd;
+static mpu6050_model_t *mpu;
+static ssd1306_model_t *oled;
+static struct timespec wall_start;
+static char *self_argv0;
+static int host_failures;  // Falhas detectadas na simulação, somadas às da verificação
+
+// --- ROTEIRO ---
+
+static void host_add_step(uint64_t t_ms, step_kind_t kind, unsigned pin, uint32_t arg) {
+    steps = realloc(steps, (size_t)(n_steps + 1) * sizeof(*steps));
+    steps[n_steps++] = (host_step_t){ t_ms * SIM_NS_PER_MS, kind, pin, arg };
+}
+
+// Linhas "<t_ms> press <1|2> [ms]", "<t_ms> hold <1|2> <ms>",
+// "<t_ms> motion <amplitude>" e "<t_ms> exit"; '#' inicia comentário
+static bool host_load_script(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    int n = 0;
+    while (fgets(line, sizeof(line), f)) {
+        n++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        unsigned long long t;
+        char verb[16];
+        unsigned a = 0, b = HOST_PRESS_MS;
+        int got = sscanf(line, "%llu %15s %u %u", &t, verb, &a, &b);
+        if (got <= 0) continue;
+        if (got >= 3 && (!strcmp(verb, "press") || !strcmp(verb, "hold")) && (a == 1 || a == 2)) {
+            host_add_step(t, STEP_PRESS, a == 1 ? HOST_BUTTON_1_PIN : HOST_BUTTON_2_PIN, b);
+        } else if (got == 3 && !strcmp(verb, "motion")) {
+            host_add_step(t, STEP_MOTION, 0, a);
+        } else if (got == 2 && !strcmp(verb, "exit")) {
+            host_add_step(t, STEP_EXIT, 0, 0);
+        } else {
+            fprintf(stderr, "%s:%d: linha inválida\n", path, n);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static uint64_t host_release(void *ctx, uint64_t when) {
+    (void)when;
+    sim_gpio_release((unsigned)(uintptr_t)ctx);
+    return 0;
+}
+
+static void host_finish(void);
+
+static uint64_t host_step(void *ctx, uint64_t when) {
+    host_step_t *s = (host_step_t *)ctx;
+    switch (s->kind) {
+        case STEP_PRESS:
+            sim_gpio_drive(s->pin, false);  // Botões ligam o pino ao GND
+            sim_event_at(when + s->arg * SIM_NS_PER_MS, host_release, (void *)(uintptr_t)s->pin);
+            break;
+        case STEP_MOTION:
+            mpu6050_model_set_motion(mpu, (int)s->arg);
+            break;
+        case STEP_EXIT:
+            host_finish();
+    }
+    return 0;
+}
+
+static uint64_t host_timeout(void *ctx, uint64_t when) {
+    (void)ctx;
+    (void)when;
+    printf("[host] tempo máximo de simulação atingido\n");
+    host_finish();
+    return 0;
+}
+
+// --- RELATÓRIO ---
+
+static double host_wall_s(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - wall_start.tv_sec) + (now.tv_nsec - wall_start.tv_nsec) / 1e9;
+}
+
+// Com o barramento parado, a GDDRAM do modelo deve ser igual ao que o
+// driver acredita ter enviado (ssd1306_t.shadow): pega envios parciais errados
+static void host_check_oled(void) {
+    if (!disp.shadow || !i2c_dma_idle(&oled_bus)) return;
+    const uint8_t *ram = ssd1306_model_ram(oled);
+    int diff = 0;
+    for (int x = 0; x < disp.width; x++)
+        for (int p = 0; p < disp.pages; p++)
+            diff += ram[p * disp.width + x] != disp.shadow[(x << 3) + p];
+    if (diff) {
+        printf("[host] SSD1306: GDDRAM difere do driver em %d bytes\n", diff);
+        host_failures++;
+    }
+}
+
+static void host_report(void) {
+    double virt = (double)sim_now_ns() / SIM_NS_PER_S;
+    double wall = host_wall_s();
+    printf("\n[host] %.3f s simulados em %.3f s (%.0fx)\n", virt, wall, wall > 0 ? virt / wall : 0);
+    printf("[host] %llu eventos, %llu trocas de núcleo, %u avisos\n",
+           (unsigned long long)sim_stats.events, (unsigned long long)sim_stats.core_switches,
+           sim_stats.warnings);
+    printf("[host] i2c0 %u transações (%u NACK), i2c1 %u (%u NACK), spi0 %llu bytes, %u DMA, %u bipes\n",
+           sim_stats.i2c_xfers[0], sim_stats.i2c_naks[0], sim_stats.i2c_xfers[1],
+           sim_stats.i2c_naks[1], (unsigned long long)sim_stats.spi_bytes[0], sim_stats.dma_xfers,
+           sim_stats.beeps);
+    sd_model_stats_t ss;
+    sd_model_get_stats(sd, &ss);
+    printf("[host] SD: %u comandos, %llu blocos lidos, %llu gravados, %u erros de CRC, "
+           "%u pausas, %.3f s ocupado\n",
+           ss.cmds, (unsigned long long)ss.blocks_read, (unsigned long long)ss.blocks_written,
+           ss.crc_errors, ss.stalls, (double)ss.busy_ns / SIM_NS_PER_S);
+    mpu6050_model_stats_t ms;
+    mpu6050_model_get_stats(mpu, &ms);
+    printf("[host] MPU6050: %u quadros na FIFO, %u perdidos por estouro, %u pulsos INT\n",
+           ms.frames, ms.overflows, ms.int_pulses);
+    ssd1306_model_stats_t os;
+    ssd1306_model_get_stats(oled, &os);
+    if (sim_stats.flash_pages)
+        printf("[host] flash: %u setores apagados, %u páginas gravadas\n",
+               sim_stats.flash_erases, sim_stats.flash_pages);
+    printf("[host] SSD1306: %u transações, %llu bytes de GDDRAM, %u comandos\n",
+           os.transactions, (unsigned long long)os.data_bytes, os.commands);
+    host_check_oled();
+}
+
+// Fim do roteiro: relatório e verificação da imagem num processo novo,
+// com o driver do cartão e o FatFs reiniciados
+static void host_finish(void) {
+    host_report();
+    if (opt.oled_dump && !ssd1306_model_dump_pbm(oled, opt.oled_dump))
+        perror(opt.oled_dump);
+    if (opt.flash && !sim_flash_save(opt.flash)) perror(opt.flash);
+    sd_model_close(sd);
+    fflush(stdout);
+    if (!opt.verify) exit(sim_stats.warnings || host_failures ? 1 : 0);
+    execl("/proc/self/exe", self_argv0, "--verify-only", "--image", opt.image,
+          host_failures ? "--failed" : NULL, (char *)NULL);
+    perror("execl");
+    exit(2);
+}
+
+// --- IMAGEM DO CARTÃO ---
+
+static void host_attach_card(void) {
+    sd = sd_model_open(opt.image, opt.size_mb * 1024 * 1024, &opt.sd_timing);
+    if (!sd) {
+        fprintf(stderr, "%s: imagem inválida (tamanho deve ser múltiplo de 512 KB)\n", opt.image);
+        exit(2);
+    }
+    sd_model_attach(sd, HOST_SD_SPI, HOST_SD_CS_PIN);
+}
+
+// Formata uma imagem nova pelo próprio driver do firmware, num processo
+// filho para que a gravação comece com o driver e o relógio zerados
+static bool host_format(void) {
+    struct stat st;
+    if (stat(opt.image, &st) == 0) return true;
+    pid_t pid = fork();
+    if (pid == 0) {
+        host_attach_card();
+        static BYTE work[FF_MAX_SS * 16];
+        const MKFS_PARM parm = { FM_FAT32, 0, 0, 0, 0 };
+        FRESULT fr = sd_init_driver() ? f_mkfs("", &parm, work, sizeof(work)) : FR_NOT_READY;
+        sd_model_close(sd);
+        printf("[host] %s: imagem de %llu MB formatada (%d)\n", opt.image,
+               (unsigned long long)opt.size_mb, fr);
+        fflush(stdout);
+        _exit(fr == FR_OK ? 0 : 1);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// --- VERIFICAÇÃO ---
+
+// Lê um varint de [*p, end); false se o bloco acabar no meio
+static bool host_varint(const uint8_t **p, const uint8_t *end, int32_t *v) {
+    uint32_t u = 0;
+    for (int shift = 0; *p < end && shift < 35; shift += 7) {
+        uint8_t b = *(*p)++;
+        u |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);  // zigzag
+            return true;
+        }
+    }
+    return false;
+}
+
+typedef struct {
+    uint32_t samples, gaps, lost, back;
+    uint32_t prev_seq;
+    uint64_t prev_ts, first_ts;
+    bool linked;  // prev_seq/prev_ts vêm do segmento anterior da sessão
+} host_verify_state_t;
+
+static void host_verify_sample(host_verify_state_t *st, uint32_t seq, uint64_t ts) {
+    if (!st->samples) st->first_ts = ts;
+    if (st->samples || st->linked) {
+        if (seq <= st->prev_seq || ts < st->prev_ts) {
+            st->back++;
+        } else if (seq != st->prev_seq + 1) {
+            st->gaps++;
+            st->lost += seq - st->prev_seq - 1;
+        }
+    }
+    st->prev_seq = seq;
+    st->prev_ts = ts;
+    st->samples++;
+}
+
+// Decodifica um bloco inteiro; false se estiver corrompido
+static bool host_verify_block(host_verify_state_t *st, const uint8_t *data) {
+    const log_block_t *b = (const log_block_t *)data;
+    const uint8_t *p = data + sizeof(log_block_t), *end = data + b->size;
+    uint32_t seq = b->seq;
+    uint64_t ts = b->timestamp_us;
+    int32_t dt = 0;
+    host_verify_sample(st, seq, ts);
+    for (uint16_t i = 1; i < b->count; i++) {
+        int32_t d;
+        if (!host_varint(&p, end, &d)) return false;
+        dt += d;
+        for (int a = 0; a < 6; a++)
+            if (!host_varint(&p, end, &d)) return false;
+        ts += (uint32_t)dt;
+        host_verify_sample(st, ++seq, ts);
+    }
+    return p == end;
+}
+
+// Verifica um segmento. 'session' traz a última amostra dos segmentos
+// anteriores da mesma sessão: a primeira deste tem de continuar a sequência.
+static int host_verify_file(const char *name, host_verify_state_t *session) {
+    FIL f;
+    if (f_open(&f, name, FA_READ) != FR_OK) {
+        printf("[verif] %s: não abriu\n", name);
+        return 1;
+    }
+    log_file_header_t h;
+    UINT br;
+    int errors = 0;
+    if (f_read(&f, &h, sizeof(h), &br) != FR_OK || br != sizeof(h) || h.magic != LOG_MAGIC ||
+        h.version != LOG_VERSION || h.header_size != sizeof(h) || h.block_samples != LOG_BLOCK_SAMPLES) {
+        printf("[verif] %s: cabeçalho inválido\n", name);
+        f_close(&f);
+        return 1;
+    }
+
+    // Blocos um a um: cabeçalho, depois o resto pelo tamanho declarado
+    static uint8_t block[LOG_BLOCK_MAX];
+    const log_block_t *b = (const log_block_t *)block;
+    host_verify_state_t st = { 0 };
+    if (session->samples || session->linked) {
+        st.prev_seq = session->prev_seq;
+        st.prev_ts = session->prev_ts;
+        st.linked = true;
+    }
+    uint32_t blocks = 0, bad = 0;
+    FSIZE_t body = f_size(&f) - sizeof(h);
+    while (h.block_count == LOG_COUNT_UNKNOWN || blocks < h.block_count) {
+        if (f_read(&f, block, sizeof(log_block_t), &br) != FR_OK || br < sizeof(log_block_t)) {
+            if (br) {
+                printf("[verif] %s: %u bytes soltos no fim\n", name, br);
+                errors++;
+            }
+            break;
+        }
+        if (b->marker != LOG_BLOCK_MARKER || b->size < sizeof(log_block_t) || b->size > LOG_BLOCK_MAX ||
+            !b->count || b->count > LOG_BLOCK_SAMPLES) {
+            printf("[verif] %s: bloco %u inválido\n", name, blocks);
+            errors++;
+            break;
+        }
+        UINT rest = b->size - sizeof(log_block_t);
+        if (f_read(&f, block + sizeof(log_block_t), rest, &br) != FR_OK || br != rest) {
+            printf("[verif] %s: bloco %u truncado\n", name, blocks);
+            errors++;
+            break;
+        }
+        if (!host_verify_block(&st, block)) bad++;
+        blocks++;
+    }
+    if (h.block_count != LOG_COUNT_UNKNOWN && f_tell(&f) != f_size(&f)) {
+        printf("[verif] %s: %u bytes após o último bloco\n", name, (unsigned)(f_size(&f) - f_tell(&f)));
+        errors++;
+    }
+    f_close(&f);
+    if (bad) {
+        printf("[verif] %s: %u blocos com varints inconsistentes\n", name, bad);
+        errors++;
+    }
+    if (st.back) {
+        printf("[verif] %s: %u amostras fora de ordem\n", name, st.back);
+        errors++;
+    }
+    double span = st.samples > 1 ? (double)(st.prev_ts - st.first_ts) / 1e6 : 0;
+    printf("[verif] %s: %u amostras em %u blocos, %.2f bytes/amostra (%.2f:1), %.3f s, %.1f Hz, "
+           "%u lacunas (%u amostras)%s%s\n", name, st.samples, blocks,
+           st.samples ? (double)body / st.samples : 0.0,
+           body ? (double)st.samples * LOG_RAW_SAMPLE_SIZE / body : 0.0,
+           span, span > 0 ? (st.samples - 1) / span : 0.0, st.gaps, st.lost,
+           h.block_count == LOG_COUNT_UNKNOWN ? ", sessão interrompida" : "",
+           errors ? " -> FALHOU" : "");
+    *session = st;
+    return errors ? 1 : 0;
+}
+
+static int host_verify(void) {
+    host_attach_card();
+    static FATFS fs;
+    if (!sd_init_driver() || f_mount(&fs, "", 1) != FR_OK) {
+        printf("[verif] %s: volume não montou\n", opt.image);
+        return 1;
+    }
+    // Uma pasta por sessão, segmentos na ordem em que foram criados
+    DIR dir, seg_dir;
+    FILINFO fno, seg;
+    int sessions = 0, files = 0, failed = 0;
+    FRESULT fr = f_findfirst(&dir, &fno, "", "datalog_*");
+    while (fr == FR_OK && fno.fname[0]) {
+        if (fno.fattrib & AM_DIR) {
+            sessions++;
+            host_verify_state_t session = { 0 };
+            FRESULT sr = f_findfirst(&seg_dir, &seg, fno.fname, "seg_*.bin");
+            while (sr == FR_OK && seg.fname[0]) {
+                char path[2 * FF_LFN_BUF + 2];
+                snprintf(path, sizeof(path), "%s/%s", fno.fname, seg.fname);
+                files++;
+                failed += host_verify_file(path, &session);
+                sr = f_findnext(&seg_dir, &seg);
+            }
+            f_closedir(&seg_dir);
+        }
+        fr = f_findnext(&dir, &fno);
+    }
+    f_closedir(&dir);
+    f_unmount("");
+    sd_model_close(sd);
+    printf("[verif] %d arquivos em %d sessões, %d com falha\n", files, sessions, failed);
+    return failed || opt.failed ? 1 : 0;
+}
+
+// --- LINHA DE COMANDO ---
+
+static void host_usage(const char *argv0) {
+    printf("uso: %s [opções]\n"
+           "  --image ARQ         imagem do cartão (padrão sd.img; criada e formatada se não existir)\n"
+           "  --size-mb N         tamanho de uma imagem nova (padrão 1024)\n"
+           "  --record S          roteiro padrão: grava S segundos e sai (padrão 10)\n"
+           "  --script ARQ        roteiro: '<t_ms> press|hold <1|2> [ms]', '<t_ms> motion <amp>', '<t_ms> exit'\n"
+           "  --max-time S        encerra a simulação após S segundos virtuais\n"
+           "  --oled-dump ARQ     grava a tela final como PBM\n"
+           "  --flash ARQ         flash lida no início e gravada no fim (padrão: apagada)\n"
+           "  --no-verify         não verifica os logs ao sair\n"
+           "  --verify-only       só verifica os logs da imagem\n"
+           "  --sd-read-us N, --sd-block-us N, --sd-single-us N, --sd-stop-us N\n"
+           "  --sd-stall-every N, --sd-stall-us N   tempos do cartão simulado\n",
+           argv0);
+}
+
+static void host_parse(int argc, char **argv) {
+    enum { O_IMAGE = 1, O_SIZE, O_RECORD, O_SCRIPT, O_MAX, O_DUMP, O_FLASH, O_NOVERIFY, O_VERIFY, O_FAILED,
+           O_READ, O_BLOCK, O_SINGLE, O_STOP, O_STALL_EVERY, O_STALL, O_HELP };
+    static const struct option longopts[] = {
+        { "image", required_argument, NULL, O_IMAGE },
+        { "size-mb", required_argument, NULL, O_SIZE },
+        { "record", required_argument, NULL, O_RECORD },
+        { "script", required_argument, NULL, O_SCRIPT },
+        { "max-time", required_argument, NULL, O_MAX },
+        { "oled-dump", required_argument, NULL, O_DUMP },
+        { "flash", required_argument, NULL, O_FLASH },
+        { "no-verify", no_argument, NULL, O_NOVERIFY },
+        { "verify-only", no_argument, NULL, O_VERIFY },
+        { "failed", no_argument, NULL, O_FAILED },
+        { "sd-read-us", required_argument, NULL, O_READ },
+        { "sd-block-us", required_argument, NULL, O_BLOCK },
+        { "sd-single-us", required_argument, NULL, O_SINGLE },
+        { "sd-stop-us", required_argument, NULL, O_STOP },
+        { "sd-stall-every", required_argument, NULL, O_STALL_EVERY },
+        { "sd-stall-us", required_argument, NULL, O_STALL },
+        { "help", no_argument, NULL, O_HELP },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        unsigned long v = optarg ? strtoul(optarg, NULL, 0) : 0;
+        switch (c) {
+            case O_IMAGE: opt.image = optarg; break;
+            case O_SIZE: opt.size_mb = v; break;
+            case O_RECORD: opt.record_s = (uint32_t)v; break;
+            case O_SCRIPT: opt.script = optarg; break;
+            case O_MAX: opt.max_s = (uint32_t)v; break;
+            case O_DUMP: opt.oled_dump = optarg; break;
+            case O_FLASH: opt.flash = optarg; break;
+            case O_NOVERIFY: opt.verify = false; break;
+            case O_VERIFY: opt.verify_only = true; break;
+            case O_FAILED: opt.failed = true; break;
+            case O_READ: opt.sd_timing.read_us = (uint32_t)v; break;
+            case O_BLOCK: opt.sd_timing.block_write_us = (uint32_t)v; break;
+            case O_SINGLE: opt.sd_timing.single_write_us = (uint32_t)v; break;
+            case O_STOP: opt.sd_timing.stop_us = (uint32_t)v; break;
+            case O_STALL_EVERY: opt.sd_timing.stall_every = (uint32_t)v; break;
+            case O_STALL: opt.sd_timing.stall_us = (uint32_t)v; break;
+            case O_HELP: host_usage(argv[0]); exit(0);
+            default: host_usage(argv[0]); exit(2);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    self_argv0 = argv[0];
+    host_parse(argc, argv);
+    stdio_init_all();
+    if (opt.verify_only) return host_verify();
+
+    if (!host_format()) {
+        fprintf(stderr, "%s: falha ao criar a imagem\n", opt.image);
+        return 2;
+    }
+    if (opt.script) {
+        if (!host_load_script(opt.script)) return 2;
+    } else {
+        uint64_t stop = HOST_BOOT_MS + (uint64_t)opt.record_s * 1000;
+        host_add_step(HOST_BOOT_MS, STEP_PRESS, HOST_BUTTON_1_PIN, HOST_PRESS_MS);
+        host_add_step(stop, STEP_PRESS, HOST_BUTTON_1_PIN, HOST_PRESS_MS);
+        host_add_step(stop + HOST_SETTLE_MS, STEP_EXIT, 0, 0);
+    }
+
+    host_attach_card();
+    sim_flash_init(opt.flash);
+    mpu = mpu6050_model_create(HOST_MPU_BUS, HOST_MPU_ADDR, HOST_MPU_INT_PIN);
+    oled = ssd1306_model_create(HOST_OLED_BUS, HOST_OLED_ADDR);
+    for (int i = 0; i < n_steps; i++) sim_event_at(steps[i].t_ns, host_step, &steps[i]);
+    sim_event_at((uint64_t)opt.max_s * SIM_NS_PER_S, host_timeout, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    datalogger_main();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Simulação em host do RP2040: tempo virtual, os dois núcleos como
+// corrotinas e os periféricos que o firmware usa (GPIO, I2C, SPI, DMA).
+// Só o tempo de barramento e as esperas explícitas (sleep, busy_wait)
+// avançam o relógio; o tempo de CPU é considerado zero.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SIM_NEVER UINT64_MAX
+#define SIM_NS_PER_US 1000ull
+#define SIM_NS_PER_MS 1000000ull
+#define SIM_NS_PER_S  1000000000ull
+
+// --- TEMPO VIRTUAL ---
+uint64_t sim_now_ns(void);
+// O núcleo atual fica ocupado por ns: o outro núcleo e os eventos vencidos
+// rodam nesse intervalo. Dentro de um evento apenas avança o relógio.
+void sim_spend_ns(uint64_t ns);
+// Espera ativa sem trabalho útil: salta até o próximo evento ou até o
+// outro núcleo voltar a rodar (no máximo SIM_IDLE_MAX_NS)
+void sim_idle(void);
+bool sim_in_irq(void);
+
+// --- EVENTOS (interrupções) ---
+// Chamado no instante 'when_ns'; retorna o próximo instante absoluto para
+// repetir o evento ou 0 para encerrá-lo
+typedef uint64_t (*sim_event_fn)(void *ctx, uint64_t when_ns);
+int sim_event_at(uint64_t when_ns, sim_event_fn fn, void *ctx);
+bool sim_event_cancel(int id);
+uint64_t sim_next_event_ns(void);
+
+// --- NÚCLEOS ---
+void sim_core1_launch(void (*entry)(void));
+void sim_core1_reset(void);
+// Bloqueia o núcleo atual até sim_wake (FIFO entre núcleos)
+void sim_block(void);
+void sim_wake(unsigned core);
+
+// --- INTERRUPÇÕES ---
+void sim_irq_raise(unsigned num);
+// Núcleo que atende a interrupção em curso; retorna o anterior
+unsigned sim_irq_set_core(unsigned core);
+
+// --- LADO DOS DISPOSITIVOS ---
+typedef struct {
+    bool (*start)(void *dev, bool read);  // START/RESTART endereçado; false = NACK
+    void (*write)(void *dev, uint8_t byte);
+    uint8_t (*read)(void *dev);
+    void (*stop)(void *dev);
+} sim_i2c_ops_t;
+void sim_i2c_attach(unsigned bus, uint8_t addr, const sim_i2c_ops_t *ops, void *dev);
+
+// Troca um byte full-duplex no instante t_ns do barramento
+typedef uint8_t (*sim_spi_xfer_fn)(void *dev, uint8_t mosi, uint64_t t_ns);
+void sim_spi_attach(unsigned bus, sim_spi_xfer_fn xfer, void *dev);
+
+// Notificado quando o firmware muda o nível de um pino de saída
+typedef void (*sim_gpio_watch_fn)(void *dev, unsigned gpio, bool level);
+void sim_gpio_watch(unsigned gpio, sim_gpio_watch_fn fn, void *dev);
+// Pino de entrada acionado de fora (botão, INT do sensor); gera as IRQs de
+// borda habilitadas. Deve ser chamado de dentro de um evento.
+void sim_gpio_drive(unsigned gpio, bool level);
+void sim_gpio_release(unsigned gpio);
+bool sim_gpio_output(unsigned gpio);
+
+// Flash apagada, ou o conteúdo do arquivo quando existe
+void sim_flash_init(const char *path);
+bool sim_flash_save(const char *path);
+
+// --- DIAGNÓSTICO ---
+typedef struct {
+    uint64_t events;          // Eventos disparados
+    uint64_t core_switches;   // Trocas de núcleo
+    uint32_t i2c_xfers[2];    // Transações por barramento (blocking e DMA)
+    uint32_t i2c_naks[2];
+    uint64_t spi_bytes[2];
+    uint32_t dma_xfers;
+    uint32_t beeps;           // Partidas do PWM do buzzer
+    uint32_t flash_erases;    // Setores apagados
+    uint32_t flash_pages;     // Páginas programadas
+    uint32_t warnings;
+} sim_stats_t;
+extern sim_stats_t sim_stats;
+
+void sim_warn(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void sim_fatal(const char *fmt, ...) __attribute__((format(printf, 1, 2), noreturn));
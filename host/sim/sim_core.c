@@ -0,0 +1,624 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "sim.h"
+#include "pico/time.h"
+#include "pico/mutex.h"
+#include "pico/sem.h"
+#include "pico/critical_section.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+// Custo de uma leitura do timer: laços que só consultam o relógio progridem
+#define SIM_TIME_READ_NS      10
+// Maior salto de uma espera ativa sem evento pendente
+#define SIM_IDLE_MAX_NS       (1 * SIM_NS_PER_MS)
+#define SIM_IDLE_MIN_NS       100
+// Espera ativa dentro de uma IRQ que não termina: o firmware travaria
+#define SIM_IRQ_SPIN_LIMIT_NS (1 * SIM_NS_PER_S)
+#define SIM_MAX_EVENTS        64
+#define SIM_MAX_ALARMS        32
+#define SIM_CORE1_STACK       (1u << 20)
+#define SIM_FIFO_DEPTH        8
+
+sim_stats_t sim_stats;
+
+// --- NÚCLEOS E RELÓGIO ---
+// Os dois núcleos são corrotinas na mesma thread. O núcleo em execução
+// só cede a vez quando gasta tempo virtual; roda então quem estiver
+// pronto mais cedo, e os eventos vencidos disparam antes disso.
+
+typedef struct {
+    ucontext_t ctx;
+    uint64_t ready_ns;  // Quando volta a rodar; SIM_NEVER se bloqueado
+    bool running;
+    bool idle;          // Em espera ativa: não segura o relógio do outro núcleo
+    bool irq_off;
+} sim_core_t;
+
+static sim_core_t cores[2] = { { .running = true } };
+static unsigned current;
+static uint64_t now_ns;
+static void (*core1_entry)(void);
+
+// Um evento roda na pilha de quem estiver em execução, mas para o firmware
+// acontece no núcleo que atende a interrupção: o 0 por padrão, ou o núcleo
+// que habilitou a IRQ (sim_irq_raise) ou criou o pool do alarme.
+static int irq_depth;
+static unsigned irq_core;
+static uint64_t irq_entry_ns;
+
+typedef struct {
+    int id;  // 0: livre
+    uint64_t when;
+    uint64_t seq;
+    sim_event_fn fn;
+    void *ctx;
+} sim_event_t;
+
+static sim_event_t events[SIM_MAX_EVENTS];
+static int last_event_id;
+static uint64_t event_seq;
+static int running_event_id;
+static bool running_event_cancelled;
+
+uint64_t sim_now_ns(void) {
+    return now_ns;
+}
+
+bool sim_in_irq(void) {
+    return irq_depth > 0;
+}
+
+unsigned sim_core_num(void) {
+    return irq_depth ? irq_core : current;
+}
+
+unsigned sim_irq_set_core(unsigned core) {
+    unsigned prev = irq_core;
+    irq_core = core;
+    return prev;
+}
+
+static int sim_event_slot(int id, uint64_t when, sim_event_fn fn, void *ctx) {
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (events[i].id) continue;
+        events[i] = (sim_event_t){ id, when, event_seq++, fn, ctx };
+        return id;
+    }
+    sim_fatal("tabela de eventos cheia (%d)", SIM_MAX_EVENTS);
+}
+
+int sim_event_at(uint64_t when_ns, sim_event_fn fn, void *ctx) {
+    if (++last_event_id <= 0) last_event_id = 1;
+    return sim_event_slot(last_event_id, when_ns, fn, ctx);
+}
+
+bool sim_event_cancel(int id) {
+    if (id <= 0) return false;
+    if (id == running_event_id) {
+        running_event_cancelled = true;
+        return true;
+    }
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (events[i].id == id) {
+            events[i].id = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int sim_next_event(void) {
+    int best = -1;
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (!events[i].id) continue;
+        if (best < 0 || events[i].when < events[best].when ||
+            (events[i].when == events[best].when && events[i].seq < events[best].seq))
+            best = i;
+    }
+    return best;
+}
+
+uint64_t sim_next_event_ns(void) {
+    int e = sim_next_event();
+    return e < 0 ? SIM_NEVER : events[e].when;
+}
+
+static void sim_run_event(int i) {
+    sim_event_t ev = events[i];
+    events[i].id = 0;
+    if (ev.when > now_ns) now_ns = ev.when;
+    running_event_id = ev.id;
+    running_event_cancelled = false;
+    irq_depth++;
+    irq_core = 0;
+    irq_entry_ns = now_ns;
+    uint64_t next = ev.fn(ev.ctx, ev.when);
+    irq_depth--;
+    running_event_id = 0;
+    sim_stats.events++;
+    if (next && !running_event_cancelled) sim_event_slot(ev.id, next, ev.fn, ev.ctx);
+}
+
+// Dispara os eventos vencidos e entrega a CPU ao núcleo pronto mais cedo
+static void sim_schedule(void) {
+    for (;;) {
+        unsigned other = current ^ 1;
+        unsigned next = current;
+        if (cores[other].running && cores[other].ready_ns <= cores[current].ready_ns &&
+            cores[other].ready_ns != SIM_NEVER)
+            next = other;
+        uint64_t t = cores[next].ready_ns;
+
+        int e = sim_next_event();
+        if (e >= 0 && !cores[0].irq_off) {
+            uint64_t horizon = t == SIM_NEVER ? SIM_NEVER : (t > now_ns ? t : now_ns);
+            if (events[e].when <= horizon) {
+                sim_run_event(e);
+                continue;
+            }
+        }
+        if (t == SIM_NEVER)
+            sim_fatal("impasse: os dois núcleos estão bloqueados e não há eventos");
+        if (t > now_ns) now_ns = t;
+        if (next != current) {
+            unsigned prev = current;
+            current = next;
+            sim_stats.core_switches++;
+            swapcontext(&cores[prev].ctx, &cores[next].ctx);
+        }
+        return;
+    }
+}
+
+void sim_spend_ns(uint64_t ns) {
+    if (irq_depth) {
+        now_ns += ns;
+        return;
+    }
+    cores[current].ready_ns = now_ns + ns;
+    cores[current].idle = false;
+    sim_schedule();
+}
+
+// Espera até o próximo evento, o outro núcleo ficar pronto ou 'limit'
+static void sim_idle_until(uint64_t limit) {
+    if (irq_depth) {
+        now_ns += SIM_IDLE_MIN_NS;
+        if (now_ns - irq_entry_ns > SIM_IRQ_SPIN_LIMIT_NS)
+            sim_fatal("espera ativa sem fim dentro de uma interrupção");
+        return;
+    }
+    uint64_t t = now_ns + SIM_IDLE_MAX_NS;
+    if (limit < t) t = limit;
+    bool progress = false;
+    if (!cores[0].irq_off) {
+        uint64_t ev = sim_next_event_ns();
+        if (ev <= t) {
+            t = ev;
+            progress = true;
+        }
+    }
+    sim_core_t *other = &cores[current ^ 1];
+    if (other->running && !other->idle && other->ready_ns <= t) {
+        t = other->ready_ns;
+        progress = true;
+    }
+    if (t <= now_ns) t = progress ? now_ns : now_ns + SIM_IDLE_MIN_NS;
+    cores[current].ready_ns = t;
+    cores[current].idle = true;
+    sim_schedule();
+}
+
+void sim_idle(void) {
+    sim_idle_until(SIM_NEVER);
+}
+
+void sim_block(void) {
+    if (irq_depth) sim_fatal("bloqueio dentro de uma interrupção");
+    cores[current].ready_ns = SIM_NEVER;
+    cores[current].idle = false;
+    sim_schedule();
+}
+
+void sim_wake(unsigned core) {
+    if (cores[core].ready_ns == SIM_NEVER) cores[core].ready_ns = now_ns;
+}
+
+void sim_wfe(void) {
+    sim_idle();
+}
+
+void sim_sev(void) {
+}
+
+static void sim_core1_main(void) {
+    core1_entry();
+    // Como no SDK, o núcleo 1 fica parado se a entrada retornar
+    for (;;) sim_block();
+}
+
+void sim_core1_launch(void (*entry)(void)) {
+    static char *stack;
+    if (cores[1].running) sim_fatal("núcleo 1 já está em execução");
+    if (!stack) stack = malloc(SIM_CORE1_STACK);
+    core1_entry = entry;
+    getcontext(&cores[1].ctx);
+    cores[1].ctx.uc_stack.ss_sp = stack;
+    cores[1].ctx.uc_stack.ss_size = SIM_CORE1_STACK;
+    cores[1].ctx.uc_link = NULL;
+    makecontext(&cores[1].ctx, sim_core1_main, 0);
+    cores[1].ready_ns = now_ns;
+    cores[1].idle = false;
+    cores[1].irq_off = false;
+    cores[1].running = true;
+}
+
+void sim_core1_reset(void) {
+    if (current == 1) sim_fatal("multicore_reset_core1 chamado no núcleo 1");
+    cores[1].running = false;
+}
+
+// --- pico/time ---
+
+absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+uint64_t time_us_64(void) {
+    sim_spend_ns(SIM_TIME_READ_NS);
+    return now_ns / SIM_NS_PER_US;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+void sleep_us(uint64_t us) {
+    sim_spend_ns(us * SIM_NS_PER_US);
+}
+
+void sleep_ms(uint32_t ms) {
+    sim_spend_ns(ms * SIM_NS_PER_MS);
+}
+
+void sleep_until(absolute_time_t t) {
+    uint64_t at = t * SIM_NS_PER_US;
+    if (at > now_ns) sim_spend_ns(at - now_ns);
+}
+
+void busy_wait_us(uint64_t us) {
+    sim_spend_ns(us * SIM_NS_PER_US);
+}
+
+void busy_wait_us_32(uint32_t us) {
+    sim_spend_ns(us * SIM_NS_PER_US);
+}
+
+void busy_wait_ms(uint32_t ms) {
+    sim_spend_ns(ms * SIM_NS_PER_MS);
+}
+
+// No SDK um alarme dá o __sev no prazo; aqui o prazo limita a espera
+bool best_effort_wfe_or_timeout(absolute_time_t t) {
+    uint64_t at = t < SIM_NEVER / SIM_NS_PER_US ? t * SIM_NS_PER_US : SIM_NEVER;
+    if (now_ns >= at) return true;
+    sim_idle_until(at);
+    return now_ns >= at;
+}
+
+struct alarm_pool {
+    unsigned core;
+};
+
+typedef struct {
+    alarm_id_t id;  // 0: livre
+    alarm_callback_t callback;
+    void *user_data;
+    unsigned core;  // Do pool
+} sim_alarm_t;
+
+static sim_alarm_t alarms[SIM_MAX_ALARMS];
+static alarm_pool_t default_pool = { 0 };
+static alarm_pool_t core1_pool = { 1 };
+
+// Retorno do callback como no SDK: 0 encerra, >0 reagenda a partir de
+// agora, <0 a partir do instante em que o alarme deveria ter disparado
+static uint64_t sim_alarm_fire(void *ctx, uint64_t when) {
+    sim_alarm_t *a = (sim_alarm_t *)ctx;
+    alarm_id_t id = a->id;
+    irq_core = a->core;
+    int64_t r = a->callback(id, a->user_data);
+    if (a->id != id) return 0;  // Cancelado dentro do callback
+    if (r == 0) {
+        a->id = 0;
+        return 0;
+    }
+    if (r < 0) return when + (uint64_t)(-r) * SIM_NS_PER_US;
+    return now_ns + (uint64_t)r * SIM_NS_PER_US;
+}
+
+static alarm_id_t sim_alarm_add(alarm_pool_t *pool, absolute_time_t t, alarm_callback_t cb,
+                                void *user_data) {
+    uint64_t when = t * SIM_NS_PER_US;
+    if (when < now_ns) when = now_ns;
+    for (int i = 0; i < SIM_MAX_ALARMS; i++) {
+        if (alarms[i].id) continue;
+        alarms[i].callback = cb;
+        alarms[i].user_data = user_data;
+        alarms[i].core = pool->core;
+        alarms[i].id = sim_event_at(when, sim_alarm_fire, &alarms[i]);
+        return alarms[i].id;
+    }
+    return -1;
+}
+
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t cb, void *user_data, bool fire_if_past) {
+    (void)fire_if_past;  // Um alarme vencido dispara no próximo ponto de escalonamento
+    return sim_alarm_add(&default_pool, t, cb, user_data);
+}
+
+alarm_pool_t *alarm_pool_get_default(void) {
+    return &default_pool;
+}
+
+// A tabela de alarmes é comum; o pool só diz em qual núcleo eles disparam
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(uint max_timers) {
+    (void)max_timers;
+    if (sim_core_num() == 0) return &default_pool;
+    return &core1_pool;
+}
+
+alarm_id_t alarm_pool_add_alarm_in_us(alarm_pool_t *pool, uint64_t us, alarm_callback_t cb,
+                                      void *user_data, bool fire_if_past) {
+    (void)fire_if_past;
+    return sim_alarm_add(pool, now_ns / SIM_NS_PER_US + us, cb, user_data);
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t cb, void *user_data, bool fire_if_past) {
+    return add_alarm_at(now_ns / SIM_NS_PER_US + us, cb, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t cb, void *user_data, bool fire_if_past) {
+    return add_alarm_in_us((uint64_t)ms * 1000, cb, user_data, fire_if_past);
+}
+
+bool cancel_alarm(alarm_id_t id) {
+    for (int i = 0; i < SIM_MAX_ALARMS; i++) {
+        if (alarms[i].id == id && id > 0) {
+            alarms[i].id = 0;
+            return sim_event_cancel(id);
+        }
+    }
+    return false;
+}
+
+// delay_us < 0: período contado entre disparos; > 0: a partir do fim do callback
+static uint64_t sim_timer_fire(void *ctx, uint64_t when) {
+    repeating_timer_t *rt = (repeating_timer_t *)ctx;
+    if (!rt->callback(rt)) return 0;
+    if (rt->delay_us < 0) return when + (uint64_t)(-rt->delay_us) * SIM_NS_PER_US;
+    return now_ns + (uint64_t)rt->delay_us * SIM_NS_PER_US;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t cb, void *user_data,
+                            repeating_timer_t *out) {
+    if (!delay_us) delay_us = 1;
+    uint64_t period = (uint64_t)(delay_us < 0 ? -delay_us : delay_us) * SIM_NS_PER_US;
+    out->delay_us = delay_us;
+    out->pool = NULL;
+    out->callback = cb;
+    out->user_data = user_data;
+    out->alarm_id = sim_event_at(now_ns + period, sim_timer_fire, out);
+    return out->alarm_id > 0;
+}
+
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t cb, void *user_data,
+                            repeating_timer_t *out) {
+    return add_repeating_timer_us((int64_t)delay_ms * 1000, cb, user_data, out);
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+    bool ok = sim_event_cancel(timer->alarm_id);
+    timer->alarm_id = 0;
+    return ok;
+}
+
+// --- hardware/sync e pico/sync ---
+
+uint32_t save_and_disable_interrupts(void) {
+    if (irq_depth) return 1;
+    uint32_t status = cores[current].irq_off;
+    cores[current].irq_off = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    if (irq_depth) return;
+    cores[current].irq_off = status != 0;
+}
+
+void critical_section_init(critical_section_t *crit_sec) {
+    crit_sec->save = 0;
+    crit_sec->initialized = true;
+}
+
+void critical_section_enter_blocking(critical_section_t *crit_sec) {
+    crit_sec->save = save_and_disable_interrupts();
+}
+
+void critical_section_exit(critical_section_t *crit_sec) {
+    restore_interrupts(crit_sec->save);
+}
+
+void critical_section_deinit(critical_section_t *crit_sec) {
+    crit_sec->initialized = false;
+}
+
+void mutex_init(mutex_t *mtx) {
+    mtx->owner = 0;
+    mtx->initialized = true;
+}
+
+// Como no SDK, o mesmo núcleo pode esperar por um mutex que ele próprio
+// pegou: quem libera pode ser uma IRQ (escrita assíncrona do cartão)
+void mutex_enter_blocking(mutex_t *mtx) {
+    while (mtx->owner) {
+        if (irq_depth) sim_fatal("mutex ocupado dentro de uma interrupção");
+        sim_idle();
+    }
+    mtx->owner = (int8_t)(sim_core_num() + 1);
+}
+
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out) {
+    if (mtx->owner) {
+        if (owner_out) *owner_out = (uint32_t)(mtx->owner - 1);
+        return false;
+    }
+    mtx->owner = (int8_t)(sim_core_num() + 1);
+    return true;
+}
+
+bool mutex_enter_timeout_ms(mutex_t *mtx, uint32_t timeout_ms) {
+    uint64_t deadline = now_ns + (uint64_t)timeout_ms * SIM_NS_PER_MS;
+    while (mtx->owner) {
+        if (irq_depth || now_ns >= deadline) return false;
+        sim_idle();
+    }
+    mtx->owner = (int8_t)(sim_core_num() + 1);
+    return true;
+}
+
+void mutex_exit(mutex_t *mtx) {
+    if (!mtx->owner) sim_warn("mutex_exit em um mutex livre");
+    mtx->owner = 0;
+}
+
+void sem_init(semaphore_t *sem, int16_t initial_permits, int16_t max_permits) {
+    sem->permits = initial_permits;
+    sem->max_permits = max_permits;
+}
+
+int sem_available(semaphore_t *sem) {
+    return sem->permits;
+}
+
+bool sem_release(semaphore_t *sem) {
+    if (sem->permits >= sem->max_permits) return false;
+    sem->permits++;
+    return true;
+}
+
+void sem_reset(semaphore_t *sem, int16_t permits) {
+    sem->permits = permits;
+}
+
+void sem_acquire_blocking(semaphore_t *sem) {
+    while (sem->permits <= 0) {
+        if (irq_depth) sim_fatal("sem_acquire_blocking dentro de uma interrupção");
+        sim_idle();
+    }
+    sem->permits--;
+}
+
+bool sem_acquire_timeout_us(semaphore_t *sem, uint32_t timeout_us) {
+    uint64_t deadline = now_ns + (uint64_t)timeout_us * SIM_NS_PER_US;
+    while (sem->permits <= 0) {
+        if (irq_depth || now_ns >= deadline) return false;
+        sim_idle();
+    }
+    sem->permits--;
+    return true;
+}
+
+bool sem_acquire_timeout_ms(semaphore_t *sem, uint32_t timeout_ms) {
+    return sem_acquire_timeout_us(sem, timeout_ms * 1000);
+}
+
+// --- pico/multicore ---
+// fifo[c] guarda as mensagens destinadas ao núcleo c
+
+static uint32_t fifo[2][SIM_FIFO_DEPTH];
+static unsigned fifo_head[2], fifo_count[2];
+
+void multicore_launch_core1(void (*entry)(void)) {
+    fifo_head[0] = fifo_head[1] = fifo_count[0] = fifo_count[1] = 0;
+    sim_core1_launch(entry);
+}
+
+void multicore_reset_core1(void) {
+    sim_core1_reset();
+}
+
+bool multicore_fifo_rvalid(void) {
+    return fifo_count[sim_core_num()] > 0;
+}
+
+bool multicore_fifo_wready(void) {
+    return fifo_count[sim_core_num() ^ 1] < SIM_FIFO_DEPTH;
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    unsigned dst = sim_core_num() ^ 1;
+    while (fifo_count[dst] == SIM_FIFO_DEPTH) sim_block();
+    fifo[dst][(fifo_head[dst] + fifo_count[dst]) % SIM_FIFO_DEPTH] = data;
+    fifo_count[dst]++;
+    sim_wake(dst);
+}
+
+static uint32_t sim_fifo_pop(unsigned core) {
+    uint32_t data = fifo[core][fifo_head[core]];
+    fifo_head[core] = (fifo_head[core] + 1) % SIM_FIFO_DEPTH;
+    fifo_count[core]--;
+    sim_wake(core ^ 1);
+    return data;
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    unsigned core = sim_core_num();
+    while (!fifo_count[core]) sim_block();
+    return sim_fifo_pop(core);
+}
+
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t *out) {
+    unsigned core = sim_core_num();
+    uint64_t deadline = now_ns + timeout_us * SIM_NS_PER_US;
+    while (!fifo_count[core]) {
+        if (now_ns >= deadline) return false;
+        sim_idle();
+    }
+    *out = sim_fifo_pop(core);
+    return true;
+}
+
+void multicore_fifo_drain(void) {
+    unsigned core = sim_core_num();
+    while (fifo_count[core]) sim_fifo_pop(core);
+}
+
+// --- DIAGNÓSTICO ---
+
+static void sim_vreport(const char *kind, const char *fmt, va_list args) {
+    fflush(stdout);
+    fprintf(stderr, "[sim %10.6f s, núcleo %u] %s: ", now_ns / 1e9, sim_core_num(), kind);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+}
+
+void sim_warn(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    sim_vreport("aviso", fmt, args);
+    va_end(args);
+    sim_stats.warnings++;
+}
+
+void sim_fatal(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    sim_vreport("erro", fmt, args);
+    va_end(args);
+    exit(2);
+}
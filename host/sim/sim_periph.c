@@ -0,0 +1,965 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "pico/stdlib.h"
+#include "pico/util/datetime.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/rtc.h"
+#include "hardware/spi.h"
+#include "hardware/structs/scb.h"
+#include "my_debug.h"
+
+// Escrita em registrador somente-leitura do lado do firmware
+#define SIM_REG(r) (*(volatile uint32_t *)&(r))
+
+#define SIM_I2C_DEVICES 4
+#define SIM_SYS_CLOCK_HZ 125000000u
+
+// --- GPIO ---
+
+typedef struct {
+    bool out;          // Direção
+    bool out_level;
+    bool pull_up, pull_down;
+    bool driven;       // Acionado de fora pela simulação
+    bool drive_level;
+    uint32_t irq_mask;
+    sim_gpio_watch_fn watch;
+    void *watch_dev;
+} sim_gpio_t;
+
+static sim_gpio_t gpios[NUM_BANK0_GPIOS];
+static gpio_irq_callback_t gpio_callback;
+
+static sim_gpio_t *sim_gpio(uint gpio) {
+    if (gpio >= NUM_BANK0_GPIOS) sim_fatal("GPIO %u inexistente", gpio);
+    return &gpios[gpio];
+}
+
+static bool sim_gpio_level(const sim_gpio_t *p) {
+    if (p->driven) return p->drive_level;
+    if (p->out) return p->out_level;
+    return p->pull_up;
+}
+
+static void sim_gpio_changed(uint gpio, bool before) {
+    sim_gpio_t *p = &gpios[gpio];
+    bool after = sim_gpio_level(p);
+    if (after == before) return;
+    if (p->out && p->watch) p->watch(p->watch_dev, gpio, after);
+    uint32_t events = p->irq_mask & (after ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+    if (!events || !gpio_callback) return;
+    if (!sim_in_irq()) sim_fatal("borda no GPIO %u fora de um evento", gpio);
+    gpio_callback(gpio, events);
+}
+
+void gpio_init(uint gpio) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    bool before = sim_gpio_level(p);
+    p->out = false;
+    p->out_level = false;
+    sim_gpio_changed(gpio, before);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)sim_gpio(gpio);
+    (void)fn;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    bool before = sim_gpio_level(p);
+    p->out = out;
+    sim_gpio_changed(gpio, before);
+}
+
+void gpio_put(uint gpio, bool value) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    bool before = sim_gpio_level(p);
+    p->out_level = value;
+    sim_gpio_changed(gpio, before);
+}
+
+bool gpio_get(uint gpio) {
+    return sim_gpio_level(sim_gpio(gpio));
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    bool before = sim_gpio_level(p);
+    p->pull_up = up;
+    p->pull_down = down;
+    sim_gpio_changed(gpio, before);
+}
+
+void gpio_set_slew_rate(uint gpio, enum gpio_slew_rate slew) {
+    (void)sim_gpio(gpio);
+    (void)slew;
+}
+
+void gpio_set_drive_strength(uint gpio, enum gpio_drive_strength drive) {
+    (void)sim_gpio(gpio);
+    (void)drive;
+}
+
+enum gpio_drive_strength gpio_get_drive_strength(uint gpio) {
+    (void)sim_gpio(gpio);
+    return GPIO_DRIVE_STRENGTH_4MA;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    if (event_mask & (GPIO_IRQ_LEVEL_LOW | GPIO_IRQ_LEVEL_HIGH))
+        sim_warn("IRQ de nível no GPIO %u não é simulada", gpio);
+    if (enabled) p->irq_mask |= event_mask;
+    else p->irq_mask &= ~event_mask;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+    if (enabled) gpio_callback = callback;
+}
+
+void sim_gpio_watch(unsigned gpio, sim_gpio_watch_fn fn, void *dev) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    p->watch = fn;
+    p->watch_dev = dev;
+}
+
+void sim_gpio_drive(unsigned gpio, bool level) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    bool before = sim_gpio_level(p);
+    p->driven = true;
+    p->drive_level = level;
+    sim_gpio_changed(gpio, before);
+}
+
+void sim_gpio_release(unsigned gpio) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    bool before = sim_gpio_level(p);
+    p->driven = false;
+    sim_gpio_changed(gpio, before);
+}
+
+bool sim_gpio_output(unsigned gpio) {
+    sim_gpio_t *p = sim_gpio(gpio);
+    return p->out && p->out_level;
+}
+
+// --- IRQ ---
+
+#define SIM_IRQ_SHARED 4
+
+static irq_handler_t irq_handlers[NUM_IRQS][SIM_IRQ_SHARED];
+// Como o NVIC, um por núcleo: bit c = habilitada no núcleo c
+static uint8_t irq_enabled[NUM_IRQS];
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num >= NUM_IRQS) return;
+    uint8_t bit = 1u << sim_core_num();
+    if (enabled) irq_enabled[num] |= bit;
+    else irq_enabled[num] &= ~bit;
+}
+
+bool irq_is_enabled(uint num) {
+    return num < NUM_IRQS && (irq_enabled[num] & (1u << sim_core_num()));
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if (num >= NUM_IRQS) sim_fatal("IRQ %u inexistente", num);
+    memset(irq_handlers[num], 0, sizeof(irq_handlers[num]));
+    irq_handlers[num][0] = handler;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    if (num >= NUM_IRQS) sim_fatal("IRQ %u inexistente", num);
+    for (int i = 0; i < SIM_IRQ_SHARED; i++) {
+        if (irq_handlers[num][i]) continue;
+        irq_handlers[num][i] = handler;
+        return;
+    }
+    sim_fatal("tratadores demais na IRQ %u", num);
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+    for (int i = 0; num < NUM_IRQS && i < SIM_IRQ_SHARED; i++)
+        if (irq_handlers[num][i] == handler) irq_handlers[num][i] = NULL;
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+    (void)num;
+    (void)hardware_priority;
+}
+
+// Atendida pelo núcleo que a habilitou (o 0, se os dois)
+void sim_irq_raise(unsigned num) {
+    if (num >= NUM_IRQS || !irq_enabled[num]) return;
+    unsigned prev = sim_irq_set_core(irq_enabled[num] & 1 ? 0 : 1);
+    for (int i = 0; i < SIM_IRQ_SHARED; i++)
+        if (irq_handlers[num][i]) irq_handlers[num][i]();
+    sim_irq_set_core(prev);
+}
+
+// --- SPI ---
+
+spi_hw_t sim_spi_hw[2];
+
+typedef struct {
+    uint baud;
+    sim_spi_xfer_fn xfer;
+    void *dev;
+    uint64_t dma_until;  // Fim da transferência DMA em andamento
+} sim_spi_bus_t;
+
+static sim_spi_bus_t spi_buses[2];
+
+void sim_spi_attach(unsigned bus, sim_spi_xfer_fn xfer, void *dev) {
+    spi_buses[bus].xfer = xfer;
+    spi_buses[bus].dev = dev;
+}
+
+static uint64_t sim_spi_byte_ns(uint bus) {
+    if (!spi_buses[bus].baud) sim_fatal("spi%u usado antes de spi_init", bus);
+    return 8 * SIM_NS_PER_S / spi_buses[bus].baud;
+}
+
+static uint8_t sim_spi_exchange(uint bus, uint8_t mosi, uint64_t t_ns) {
+    sim_spi_bus_t *b = &spi_buses[bus];
+    sim_stats.spi_bytes[bus]++;
+    return b->xfer ? b->xfer(b->dev, mosi, t_ns) : 0xFF;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+    return spi_set_baudrate(spi, baudrate);
+}
+
+void spi_deinit(spi_inst_t *spi) {
+    spi_buses[spi_get_index(spi)].baud = 0;
+}
+
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate) {
+    spi_buses[spi_get_index(spi)].baud = baudrate;
+    return baudrate;
+}
+
+uint spi_get_baudrate(const spi_inst_t *spi) {
+    return spi_buses[spi_get_index(spi)].baud;
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha,
+                    spi_order_t order) {
+    if (data_bits != 8 || cpol != SPI_CPOL_0 || cpha != SPI_CPHA_0 || order != SPI_MSB_FIRST)
+        sim_warn("spi%u: só o modo 0 de 8 bits é simulado", spi_get_index(spi));
+}
+
+static int sim_spi_polled(spi_inst_t *spi, const uint8_t *src, uint8_t repeated, uint8_t *dst,
+                          size_t len) {
+    uint bus = spi_get_index(spi);
+    uint64_t byte_ns = sim_spi_byte_ns(bus);
+    uint64_t t = sim_now_ns();
+    if (spi_buses[bus].dma_until > t) sim_warn("spi%u: acesso direto durante um DMA", bus);
+    for (size_t i = 0; i < len; i++) {
+        uint8_t miso = sim_spi_exchange(bus, src ? src[i] : repeated, t + i * byte_ns);
+        if (dst) dst[i] = miso;
+    }
+    sim_spend_ns(len * byte_ns);
+    return (int)len;
+}
+
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    return sim_spi_polled(spi, src, 0, dst, len);
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    return sim_spi_polled(spi, src, 0, NULL, len);
+}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len) {
+    return sim_spi_polled(spi, NULL, repeated_tx_data, dst, len);
+}
+
+// --- I2C ---
+
+static i2c_hw_t sim_i2c_hw[2];
+i2c_inst_t i2c0_inst = { &sim_i2c_hw[0], false };
+i2c_inst_t i2c1_inst = { &sim_i2c_hw[1], false };
+
+typedef struct {
+    uint8_t addr;
+    const sim_i2c_ops_t *ops;
+    void *dev;
+} sim_i2c_dev_t;
+
+typedef struct {
+    uint baud;
+    sim_i2c_dev_t devs[SIM_I2C_DEVICES];
+    int ndevs;
+    uint64_t dma_until;
+    // Transação DMA em andamento
+    uint32_t dma_mask;
+    uint32_t dma_raw;
+} sim_i2c_bus_t;
+
+static sim_i2c_bus_t i2c_buses[2];
+
+void sim_i2c_attach(unsigned bus, uint8_t addr, const sim_i2c_ops_t *ops, void *dev) {
+    sim_i2c_bus_t *b = &i2c_buses[bus];
+    if (b->ndevs == SIM_I2C_DEVICES) sim_fatal("dispositivos demais no i2c%u", bus);
+    b->devs[b->ndevs++] = (sim_i2c_dev_t){ addr, ops, dev };
+}
+
+static sim_i2c_dev_t *sim_i2c_find(uint bus, uint8_t addr) {
+    for (int i = 0; i < i2c_buses[bus].ndevs; i++)
+        if (i2c_buses[bus].devs[i].addr == addr) return &i2c_buses[bus].devs[i];
+    return NULL;
+}
+
+// Cada byte leva 9 bits de SCL; START e STOP contam como mais um
+static uint64_t sim_i2c_ns(uint bus, uint64_t bits) {
+    if (!i2c_buses[bus].baud) sim_fatal("i2c%u usado antes de i2c_init", bus);
+    return bits * SIM_NS_PER_S / i2c_buses[bus].baud;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    memset(i2c->hw, 0, sizeof(*i2c->hw));
+    i2c->hw->enable = 1;
+    i2c->restart_on_next = false;
+    return i2c_set_baudrate(i2c, baudrate);
+}
+
+void i2c_deinit(i2c_inst_t *i2c) {
+    i2c_buses[i2c_hw_index(i2c)].baud = 0;
+}
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate) {
+    i2c_buses[i2c_hw_index(i2c)].baud = baudrate;
+    return baudrate;
+}
+
+static int sim_i2c_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, uint8_t *dst,
+                            size_t len, bool nostop) {
+    uint bus = i2c_hw_index(i2c);
+    sim_i2c_bus_t *b = &i2c_buses[bus];
+    if (b->dma_until > sim_now_ns()) sim_warn("i2c%u: acesso direto durante um DMA", bus);
+    sim_i2c_dev_t *d = sim_i2c_find(bus, addr);
+    uint64_t bits = 10;
+    if (!d || !d->ops->start(d->dev, dst != NULL)) {
+        sim_stats.i2c_naks[bus]++;
+        sim_spend_ns(sim_i2c_ns(bus, bits + 1));
+        i2c->restart_on_next = false;
+        return PICO_ERROR_GENERIC;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (dst) dst[i] = d->ops->read(d->dev);
+        else d->ops->write(d->dev, src[i]);
+        bits += 9;
+    }
+    if (!nostop) {
+        d->ops->stop(d->dev);
+        sim_stats.i2c_xfers[bus]++;
+        bits++;
+    }
+    i2c->restart_on_next = nostop;
+    sim_spend_ns(sim_i2c_ns(bus, bits));
+    return (int)len;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    return sim_i2c_blocking(i2c, addr, src, NULL, len, nostop);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    return sim_i2c_blocking(i2c, addr, NULL, dst, len, nostop);
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len,
+                         bool nostop, uint timeout_us) {
+    (void)timeout_us;
+    return sim_i2c_blocking(i2c, addr, src, NULL, len, nostop);
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop,
+                        uint timeout_us) {
+    (void)timeout_us;
+    return sim_i2c_blocking(i2c, addr, NULL, dst, len, nostop);
+}
+
+// --- DMA ---
+// Os dados se movem todos no disparo do canal; a conclusão (busy, IRQ)
+// é um evento no instante em que o último byte sairia do barramento.
+
+static dma_hw_t sim_dma_regs;
+dma_hw_t *dma_hw = &sim_dma_regs;
+
+typedef struct {
+    bool claimed;
+    bool busy;
+    dma_channel_config cfg;
+    volatile void *write_addr;
+    const volatile void *read_addr;
+    uint32_t count;
+    bool irq0, irq1;
+    int done_event;
+} sim_dma_ch_t;
+
+static sim_dma_ch_t dma_ch[NUM_DMA_CHANNELS];
+static int sniff_channel = -1;
+static uint sniff_mode;
+
+static sim_dma_ch_t *sim_dma(uint channel) {
+    if (channel >= NUM_DMA_CHANNELS) sim_fatal("canal DMA %u inexistente", channel);
+    return &dma_ch[channel];
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = { 0 };
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_enable(&c, true);
+    return c;
+}
+
+void dma_channel_claim(uint channel) {
+    if (sim_dma(channel)->claimed) sim_fatal("canal DMA %u já reservado", channel);
+    dma_ch[channel].claimed = true;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (dma_ch[ch].claimed) continue;
+        dma_ch[ch].claimed = true;
+        return (int)ch;
+    }
+    if (required) sim_fatal("sem canais DMA livres");
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    sim_dma(channel)->claimed = false;
+}
+
+bool dma_channel_is_claimed(uint channel) {
+    return sim_dma(channel)->claimed;
+}
+
+static uint sim_dma_size(const sim_dma_ch_t *c) {
+    return 1u << ((c->cfg.ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+
+static bool sim_dma_sniffed(uint channel) {
+    return (int)channel == sniff_channel &&
+           (dma_ch[channel].cfg.ctrl & DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS) &&
+           (dma_hw->sniff_ctrl & 1u);
+}
+
+static void sim_dma_sniff(uint8_t byte) {
+    uint32_t acc = dma_hw->sniff_data;
+    switch (sniff_mode) {
+        case DMA_SNIFF_CTRL_CALC_VALUE_CRC16:  // CRC-16-CCITT, MSB primeiro
+            acc ^= (uint32_t)byte << 8;
+            for (int i = 0; i < 8; i++) acc = (acc & 0x8000) ? (acc << 1) ^ 0x1021 : acc << 1;
+            acc &= 0xFFFF;
+            break;
+        case DMA_SNIFF_CTRL_CALC_VALUE_SUM:
+            acc += byte;
+            break;
+        default:
+            sim_fatal("modo %u do sniffer não simulado", sniff_mode);
+    }
+    dma_hw->sniff_data = acc;
+}
+
+// Lê/escreve o elemento i do lado de memória de um canal
+static uint32_t sim_dma_load(const sim_dma_ch_t *c, uint32_t i) {
+    uint size = sim_dma_size(c);
+    uint32_t off = (c->cfg.ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS) ? i * size : 0;
+    uint32_t v = 0;
+    memcpy(&v, (const uint8_t *)c->read_addr + off, size);
+    return v;
+}
+
+static void sim_dma_store(const sim_dma_ch_t *c, uint32_t i, uint32_t v) {
+    uint size = sim_dma_size(c);
+    uint32_t off = (c->cfg.ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) ? i * size : 0;
+    memcpy((uint8_t *)c->write_addr + off, &v, size);
+}
+
+static void sim_dma_sniff_word(uint channel, uint32_t v) {
+    if (!sim_dma_sniffed(channel)) return;
+    for (uint b = 0; b < sim_dma_size(&dma_ch[channel]); b++) sim_dma_sniff((uint8_t)(v >> (8 * b)));
+}
+
+// Canal armado lendo do registrador 'reg' (RX de SPI ou I2C)
+static int sim_dma_reader_of(const volatile void *reg) {
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+        if (dma_ch[ch].busy && dma_ch[ch].read_addr == reg) return (int)ch;
+    return -1;
+}
+
+static void sim_dma_complete(uint32_t mask) {
+    uint32_t irq0 = 0, irq1 = 0;
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!(mask & (1u << ch)) || !dma_ch[ch].busy) continue;
+        dma_ch[ch].busy = false;
+        dma_ch[ch].done_event = 0;
+        if (dma_ch[ch].irq0) irq0 |= 1u << ch;
+        if (dma_ch[ch].irq1) irq1 |= 1u << ch;
+    }
+    if (irq0) {
+        dma_hw->ints0 |= irq0;
+        sim_irq_raise(DMA_IRQ_0);
+        dma_hw->ints0 &= ~irq0;
+    }
+    if (irq1) {
+        dma_hw->ints1 |= irq1;
+        sim_irq_raise(DMA_IRQ_1);
+        dma_hw->ints1 &= ~irq1;
+    }
+}
+
+static uint64_t sim_dma_done(void *ctx, uint64_t when) {
+    (void)when;
+    sim_dma_complete((uint32_t)(uintptr_t)ctx);
+    return 0;
+}
+
+static void sim_dma_finish_at(uint64_t when, uint32_t mask) {
+    int id = sim_event_at(when, sim_dma_done, (void *)(uintptr_t)mask);
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+        if (mask & (1u << ch)) dma_ch[ch].done_event = id;
+}
+
+static void sim_dma_run_spi(uint tx, uint bus) {
+    sim_dma_ch_t *c = &dma_ch[tx];
+    int rx = sim_dma_reader_of(&sim_spi_hw[bus].dr);
+    if (sim_dma_size(c) != 1 || (rx >= 0 && sim_dma_size(&dma_ch[rx]) != 1))
+        sim_fatal("DMA no spi%u com elementos maiores que 8 bits", bus);
+    if (rx >= 0 && dma_ch[rx].count < c->count)
+        sim_fatal("DMA no spi%u: canal RX menor que o TX", bus);
+    uint64_t byte_ns = sim_spi_byte_ns(bus);
+    uint64_t t = sim_now_ns();
+    for (uint32_t i = 0; i < c->count; i++) {
+        uint8_t mosi = (uint8_t)sim_dma_load(c, i);
+        sim_dma_sniff_word(tx, mosi);
+        uint8_t miso = sim_spi_exchange(bus, mosi, t + i * byte_ns);
+        if (rx >= 0) {
+            sim_dma_store(&dma_ch[rx], i, miso);
+            sim_dma_sniff_word((uint)rx, miso);
+        }
+    }
+    uint64_t end = t + c->count * byte_ns;
+    spi_buses[bus].dma_until = end;
+    sim_dma_finish_at(end, (1u << tx) | (rx >= 0 ? 1u << rx : 0));
+}
+
+// Executa as palavras de IC_DATA_CMD (byte + bits CMD/STOP/RESTART) contra
+// o dispositivo em IC_TAR. Um NACK encerra a transação com TX_ABRT.
+static uint64_t sim_i2c_dma_done(void *ctx, uint64_t when) {
+    (void)when;
+    sim_i2c_bus_t *b = (sim_i2c_bus_t *)ctx;
+    uint bus = (uint)(b - i2c_buses);
+    i2c_hw_t *hw = bus ? i2c1->hw : i2c0->hw;
+    sim_dma_complete(b->dma_mask);
+    SIM_REG(hw->raw_intr_stat) = b->dma_raw;
+    SIM_REG(hw->intr_stat) = b->dma_raw & hw->intr_mask;
+    if (hw->intr_stat) sim_irq_raise(I2C0_IRQ + bus);
+    // Leitura de IC_CLR_INTR pelo tratador
+    SIM_REG(hw->raw_intr_stat) = 0;
+    SIM_REG(hw->intr_stat) = 0;
+    return 0;
+}
+
+static void sim_dma_run_i2c(uint tx, uint bus) {
+    sim_i2c_bus_t *b = &i2c_buses[bus];
+    i2c_hw_t *hw = bus ? i2c1->hw : i2c0->hw;
+    sim_dma_ch_t *c = &dma_ch[tx];
+    int rx = sim_dma_reader_of(&hw->data_cmd);
+    sim_i2c_dev_t *d = sim_i2c_find(bus, (uint8_t)(hw->tar & 0x7F));
+    uint64_t bits = 0;
+    uint32_t received = 0;
+    bool open = false, reading = false, nack = false;
+
+    for (uint32_t i = 0; i < c->count && !nack; i++) {
+        uint32_t w = sim_dma_load(c, i);
+        bool read = w & I2C_IC_DATA_CMD_CMD_BITS;
+        if (!open || read != reading || (w & I2C_IC_DATA_CMD_RESTART_BITS)) {
+            bits += 10;
+            if (!d || !d->ops->start(d->dev, read)) {
+                nack = true;
+                break;
+            }
+            open = true;
+            reading = read;
+        }
+        if (read) {
+            uint8_t byte = d->ops->read(d->dev);
+            if (rx < 0 || received >= dma_ch[rx].count)
+                sim_fatal("i2c%u: leitura por DMA sem canal RX armado", bus);
+            sim_dma_store(&dma_ch[rx], received++, byte);
+        } else {
+            d->ops->write(d->dev, (uint8_t)(w & I2C_IC_DATA_CMD_DAT_BITS));
+        }
+        bits += 9;
+        if (w & I2C_IC_DATA_CMD_STOP_BITS) {
+            d->ops->stop(d->dev);
+            sim_stats.i2c_xfers[bus]++;
+            open = false;
+            bits++;
+        }
+    }
+    if (nack) {
+        sim_stats.i2c_naks[bus]++;
+        if (open) d->ops->stop(d->dev);
+        bits++;
+    } else if (open) {
+        sim_warn("i2c%u: transação por DMA sem STOP", bus);
+    }
+
+    uint64_t end = sim_now_ns() + sim_i2c_ns(bus, bits);
+    b->dma_until = end;
+    b->dma_mask = (1u << tx) | (rx >= 0 ? 1u << rx : 0);
+    b->dma_raw = nack ? I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS | I2C_IC_RAW_INTR_STAT_STOP_DET_BITS
+                      : (open ? 0 : I2C_IC_RAW_INTR_STAT_STOP_DET_BITS);
+    int id = sim_event_at(end, sim_i2c_dma_done, b);
+    dma_ch[tx].done_event = id;
+    if (rx >= 0) dma_ch[rx].done_event = id;
+}
+
+// Memória para memória: um elemento por ciclo do clk_sys
+static void sim_dma_run_mem(uint ch) {
+    sim_dma_ch_t *c = &dma_ch[ch];
+    for (uint32_t i = 0; i < c->count; i++) {
+        uint32_t v = sim_dma_load(c, i);
+        sim_dma_sniff_word(ch, v);
+        sim_dma_store(c, i, v);
+    }
+    uint64_t end = sim_now_ns() + (uint64_t)c->count * SIM_NS_PER_S / SIM_SYS_CLOCK_HZ;
+    sim_dma_finish_at(end, 1u << ch);
+}
+
+static bool sim_dma_is_periph(const volatile void *addr) {
+    for (int i = 0; i < 2; i++)
+        if (addr == &sim_spi_hw[i].dr || addr == &sim_i2c_hw[i].data_cmd) return true;
+    return false;
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!(chan_mask & (1u << ch))) continue;
+        if (dma_ch[ch].busy) sim_warn("canal DMA %u disparado ainda ocupado", ch);
+        dma_ch[ch].busy = true;
+    }
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!(chan_mask & (1u << ch))) continue;
+        sim_dma_ch_t *c = &dma_ch[ch];
+        sim_stats.dma_xfers++;
+        if (!c->count) {
+            sim_dma_finish_at(sim_now_ns(), 1u << ch);
+        } else if (c->write_addr == &sim_spi_hw[0].dr || c->write_addr == &sim_spi_hw[1].dr) {
+            sim_dma_run_spi(ch, c->write_addr == &sim_spi_hw[1].dr);
+        } else if (c->write_addr == &sim_i2c_hw[0].data_cmd || c->write_addr == &sim_i2c_hw[1].data_cmd) {
+            sim_dma_run_i2c(ch, c->write_addr == &sim_i2c_hw[1].data_cmd);
+        } else if (!sim_dma_is_periph(c->read_addr)) {
+            sim_dma_run_mem(ch);
+        }
+        // Leitores de periférico ficam armados à espera do canal que alimenta o barramento
+    }
+}
+
+void dma_channel_start(uint channel) {
+    dma_start_channel_mask(1u << channel);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    sim_dma_ch_t *c = sim_dma(channel);
+    if (c->busy) sim_warn("canal DMA %u reconfigurado ainda ocupado", channel);
+    c->cfg = *config;
+    c->write_addr = write_addr;
+    c->read_addr = read_addr;
+    c->count = transfer_count;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger) {
+    sim_dma(channel)->cfg = *config;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+    sim_dma(channel)->read_addr = read_addr;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger) {
+    sim_dma(channel)->write_addr = write_addr;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    sim_dma(channel)->count = trans_count;
+    if (trigger) dma_channel_start(channel);
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return sim_dma(channel)->busy;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+    while (sim_dma(channel)->busy) sim_idle();
+}
+
+// Descarta a conclusão pendente; um leitor armado que nunca recebeu o
+// canal de alimentação simplesmente deixa de esperar
+void dma_channel_abort(uint channel) {
+    sim_dma_ch_t *c = sim_dma(channel);
+    if (!c->busy) return;
+    int id = c->done_event;
+    c->busy = false;
+    c->done_event = 0;
+    if (!id) return;
+    bool shared = false;
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+        if (dma_ch[ch].done_event == id) shared = true;
+    if (!shared) sim_event_cancel(id);
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    sim_dma(channel)->irq0 = enabled;
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    sim_dma(channel)->irq1 = enabled;
+}
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable) {
+    sniff_channel = (int)channel;
+    sniff_mode = mode;
+    if (force_channel_enable) channel_config_set_sniff_enable(&sim_dma(channel)->cfg, true);
+    dma_hw->sniff_ctrl = 1u | (channel << 1) | (mode << 5);
+}
+
+void dma_sniffer_disable(void) {
+    dma_hw->sniff_ctrl = 0;
+    sniff_channel = -1;
+}
+
+// --- FLASH (config_store) ---
+// NOR: o apagamento leva o setor a 0xFF e a programação só zera bits.
+// Tempos típicos do W25Q16 da Pico W.
+
+#define SIM_FLASH_ERASE_NS   (45 * SIM_NS_PER_MS)
+#define SIM_FLASH_PROGRAM_NS (800 * SIM_NS_PER_US)
+
+uint8_t sim_flash_xip[PICO_FLASH_SIZE_BYTES];
+
+void sim_flash_init(const char *path) {
+    memset(sim_flash_xip, 0xFF, sizeof(sim_flash_xip));
+    FILE *f = path ? fopen(path, "rb") : NULL;
+    if (!f) return;
+    if (fread(sim_flash_xip, 1, sizeof(sim_flash_xip), f) != sizeof(sim_flash_xip))
+        sim_warn("%s: flash menor que %u bytes", path, PICO_FLASH_SIZE_BYTES);
+    fclose(f);
+}
+
+bool sim_flash_save(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(sim_flash_xip, 1, sizeof(sim_flash_xip), f) == sizeof(sim_flash_xip);
+    return fclose(f) == 0 && ok;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES)
+        sim_fatal("flash_range_erase(0x%x, %zu) desalinhado", flash_offs, count);
+    memset(&sim_flash_xip[flash_offs], 0xFF, count);
+    sim_stats.flash_erases += count / FLASH_SECTOR_SIZE;
+    sim_spend_ns(SIM_FLASH_ERASE_NS * (count / FLASH_SECTOR_SIZE));
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES)
+        sim_fatal("flash_range_program(0x%x, %zu) desalinhado", flash_offs, count);
+    for (size_t i = 0; i < count; i++) sim_flash_xip[flash_offs + i] &= data[i];
+    sim_stats.flash_pages += count / FLASH_PAGE_SIZE;
+    sim_spend_ns(SIM_FLASH_PROGRAM_NS * (count / FLASH_PAGE_SIZE));
+}
+
+// --- PWM (buzzer) ---
+
+static uint16_t pwm_level[NUM_BANK0_GPIOS];
+static int pwm_active;
+
+void pwm_init(uint slice_num, pwm_config *c, bool start) {
+    (void)slice_num;
+    (void)c;
+    (void)start;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+    (void)slice_num;
+    (void)wrap;
+}
+
+void pwm_set_clkdiv(uint slice_num, float divider) {
+    (void)slice_num;
+    (void)divider;
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+    (void)slice_num;
+    (void)enabled;
+}
+
+// Um bipe começa quando o primeiro pino sai do nível zero
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+    if (gpio >= NUM_BANK0_GPIOS) sim_fatal("GPIO %u inexistente", gpio);
+    if (!pwm_level[gpio] && level) {
+        if (!pwm_active++) sim_stats.beeps++;
+    } else if (pwm_level[gpio] && !level) {
+        pwm_active--;
+    }
+    pwm_level[gpio] = level;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level) {
+    pwm_set_gpio_level(slice_num * 2 + chan, level);
+}
+
+// --- CLOCKS, RTC, STDIO ---
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    switch (clk_index) {
+        case clk_ref: return 12000000u;
+        case clk_usb:
+        case clk_adc: return 48000000u;
+        case clk_rtc: return 46875u;
+        default: return SIM_SYS_CLOCK_HZ;
+    }
+}
+
+// Como no RP2040, o RTC só conta depois de rtc_set_datetime
+static bool rtc_on;
+static time_t rtc_base;
+static uint64_t rtc_base_ns;
+
+void rtc_init(void) {
+}
+
+bool rtc_set_datetime(const datetime_t *t) {
+    struct tm tm = { .tm_year = t->year - 1900, .tm_mon = t->month - 1, .tm_mday = t->day,
+                     .tm_hour = t->hour, .tm_min = t->min, .tm_sec = t->sec };
+    rtc_base = timegm(&tm);
+    rtc_base_ns = sim_now_ns();
+    rtc_on = true;
+    return true;
+}
+
+bool rtc_get_datetime(datetime_t *t) {
+    if (!rtc_on) return false;
+    time_t now = rtc_base + (time_t)((sim_now_ns() - rtc_base_ns) / SIM_NS_PER_S);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    *t = (datetime_t){ (int16_t)(tm.tm_year + 1900), (int8_t)(tm.tm_mon + 1), (int8_t)tm.tm_mday,
+                       (int8_t)tm.tm_wday, (int8_t)tm.tm_hour, (int8_t)tm.tm_min, (int8_t)tm.tm_sec };
+    return true;
+}
+
+bool rtc_running(void) {
+    return rtc_on;
+}
+
+bool stdio_init_all(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+void stdio_flush(void) {
+    fflush(stdout);
+}
+
+#undef printf
+#undef sprintf
+#undef snprintf
+
+// Copia o formato sem o modificador 'l' isolado: com long de 32 bits no
+// firmware, todo argumento "%l" é um inteiro de 32 bits. A cópia nunca é
+// maior que o original, então um buffer de strlen(fmt) + 1 basta.
+static const char *sim_ilp32_format(const char *fmt, char *out, size_t size) {
+    size_t n = 0;
+    for (const char *p = fmt; *p && n + 1 < size; p++) {
+        out[n++] = *p;
+        if (*p != '%') continue;
+        while (p[1] && strchr("-+ #0123456789.*", p[1]) && n + 1 < size) out[n++] = *++p;
+        if (p[1] == 'l' && p[2] != 'l') p++;
+        else if (p[1] == 'l') {
+            out[n++] = *++p;
+            if (n + 1 < size) out[n++] = *++p;
+        }
+    }
+    out[n] = 0;
+    return out;
+}
+
+int sim_printf(const char *fmt, ...) {
+    char f[strlen(fmt) + 1];
+    va_list args;
+    va_start(args, fmt);
+    int r = vprintf(sim_ilp32_format(fmt, f, sizeof(f)), args);
+    va_end(args);
+    return r;
+}
+
+int sim_sprintf(char *buf, const char *fmt, ...) {
+    char f[strlen(fmt) + 1];
+    va_list args;
+    va_start(args, fmt);
+    int r = vsprintf(buf, sim_ilp32_format(fmt, f, sizeof(f)), args);
+    va_end(args);
+    return r;
+}
+
+int sim_snprintf(char *buf, size_t size, const char *fmt, ...) {
+    char f[strlen(fmt) + 1];
+    va_list args;
+    va_start(args, fmt);
+    int r = vsnprintf(buf, size, sim_ilp32_format(fmt, f, sizeof(f)), args);
+    va_end(args);
+    return r;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    sim_spend_ns((uint64_t)timeout_us * SIM_NS_PER_US);
+    return PICO_ERROR_TIMEOUT;
+}
+
+static armv6m_scb_hw_t sim_scb;
+armv6m_scb_hw_t *scb_hw = &sim_scb;
+
+// Substituem src/my_debug.c, que para o Cortex-M0+ com instruções próprias
+void my_printf(const char *pcFormat, ...) {
+    va_list args;
+    va_start(args, pcFormat);
+    vprintf(pcFormat, args);
+    va_end(args);
+    fflush(stdout);
+}
+
+void my_assert_func(const char *file, int line, const char *func, const char *pred) {
+    sim_fatal("assertion \"%s\" failed: file \"%s\", line %d, function: %s", pred, file, line, func);
+}
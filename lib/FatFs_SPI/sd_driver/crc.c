@@ -28,6 +28,8 @@ specific language governing permissions and limitations under the License.
  * limitations under the License.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "crc.h"
 
 static const char m_Crc7Table[] = {0x00, 0x09, 0x12, 0x1B, 0x24, 0x2D, 0x36,
@@ -113,4 +115,37 @@ void update_crc16(unsigned short *pCrc16, const char data[], size_t length) {
 		*pCrc16 = (*pCrc16 << 8) ^ m_Crc16Table[((*pCrc16 >> 8) ^ data[i]) & 0x00FF];
 	}    
 }
+// Slice-by-4: m_Crc16Slice[k][x] is the CRC of byte x followed by k+1 zero
+// bytes, so four input bytes cost four table lookups instead of a serial
+// chain of four. Built in RAM from m_Crc16Table on first use (1.5 KB).
+static unsigned short m_Crc16Slice[3][256];
+static bool m_Crc16SliceReady;
+
+static void crc16_slice4_init(void)
+{
+	for (int i = 0; i < 256; i++) {
+		unsigned short c = m_Crc16Table[i];
+		for (int k = 0; k < 3; k++) {
+			c = (c << 8) ^ m_Crc16Table[c >> 8];
+			m_Crc16Slice[k][i] = c;
+		}
+	}
+	m_Crc16SliceReady = true;
+}
+
+unsigned short crc16_slice4(const void* data, size_t length)
+{
+	const uint8_t *p = data;
+	uint16_t crc = 0;
+	if (!m_Crc16SliceReady)
+		crc16_slice4_init();
+	for (; length >= 4; length -= 4, p += 4) {
+		uint16_t x = crc ^ (p[0] << 8 | p[1]);
+		crc = m_Crc16Slice[2][x >> 8] ^ m_Crc16Slice[1][x & 0xFF] ^
+		      m_Crc16Slice[0][p[2]] ^ m_Crc16Table[p[3]];
+	}
+	while (length--)
+		crc = (crc << 8) ^ m_Crc16Table[(crc >> 8) ^ *p++];
+	return crc;
+}
 /* [] END OF FILE */
@@ -174,11 +174,18 @@ specific language governing permissions and limitations under the License.
 #include "ff.h" /* Obtains integer types */
 //
 #include "diskio.h" /* Declarations of disk functions */  // Needed for STA_NOINIT, ...
+//
+#include "lib/latency.h"  // Command, data and busy histograms (LATENCY_STATS)
 
 #ifndef SD_CRC_ENABLED
 #define SD_CRC_ENABLED 1
 #endif
 
+// Data block CRC from the DMA sniffer; 0 computes it in software
+#ifndef SD_DMA_CRC
+#define SD_DMA_CRC 1
+#endif
+
 #if SD_CRC_ENABLED
 #include "crc.h"
 static bool crc_on = true;
@@ -297,6 +304,7 @@ typedef enum {
 static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
     uint8_t response;
     char cmdPacket[PACKET_SIZE];
+    LATENCY_BEGIN(start);
 
     // Prepare the command packet
     cmdPacket[0] = SPI_CMD(cmd);
@@ -325,10 +333,8 @@ static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
                 break;
         }
     }
-    // send a command
-    for (int i = 0; i < PACKET_SIZE; i++) {
-        sd_spi_write(pSD, cmdPacket[i]);
-    }
+    // send a command: the whole packet in one (polled) transfer
+    sd_spi_transfer(pSD, (const uint8_t *)cmdPacket, NULL, PACKET_SIZE);
     // The received byte immediataly following CMD12 is a stuff byte,
     // it should be discarded before receive the response of the CMD12.
     if (CMD12_STOP_TRANSMISSION == cmd) {
@@ -343,19 +349,26 @@ static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
             break;
         }
     }
+    LATENCY_END(LAT_SD_CMD, start);
     return response;
 }
 
 static bool sd_wait_ready(sd_card_t *pSD, int timeout) {
     char resp;
 
+    // Most calls find the card idle: one byte, no timeout bookkeeping
+    resp = sd_spi_write(pSD, 0xFF);
+    if (resp != 0x00) return true;
+
     // Keep sending dummy clocks with DI held high until the card releases the
-    // DO line
+    // DO line. Only real busy periods go into the histogram.
+    LATENCY_BEGIN(start);
     absolute_time_t timeout_time = make_timeout_time_ms(timeout);
     do {
         resp = sd_spi_write(pSD, 0xFF);
     } while (resp == 0x00 &&
              0 < absolute_time_diff_us(get_absolute_time(), timeout_time));
+    LATENCY_END(LAT_SD_BUSY, start);
 
     if (resp == 0x00) DBG_PRINTF("%s failed\r\n", __FUNCTION__);
 
@@ -450,6 +463,19 @@ static const char *cmd2str(const cmdSupported cmd) {
 #define SD_COMMAND_RETRIES 3 /*!< Times SPI cmd is retried when there is no response */
 #define SD_COMMAND_TIMEOUT 2000 /*!< Timeout in ms for response */
 
+// Ends an open CMD25 stream with the Stop Tran token and waits for the card
+// to finish programming the last block.
+static void sd_stream_stop(sd_card_t *pSD) {
+    sd_spi_write(pSD, SPI_STOP_TRAN);
+    sd_spi_write(pSD, SPI_FILL_CHAR);  // Nbr: busy starts one byte later
+    if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
+        DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
+    }
+    sd_spi_deselect_pulse(pSD);
+    pSD->stream_open = false;
+    pSD->stream_stale = false;
+}
+
 static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
                   bool isAcmd, uint32_t *resp) {
     TRACE_PRINTF("%s(%s(0x%08lx)): ", __FUNCTION__, cmd2str(cmd), arg);
@@ -457,6 +483,9 @@ static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response;
 
+    // A streaming CMD25 must be closed before the card accepts any command
+    if (pSD->stream_open) sd_stream_stop(pSD);
+
     // No need to wait for card to be ready when sending the stop command
     if (CMD12_STOP_TRANSMISSION != cmd) {
         if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
@@ -730,8 +759,8 @@ static uint64_t sd_sectors_nolock(sd_card_t *pSD) {
                        block_len;  // memory capacity = BLOCKNR * BLOCK_LEN
             blocks = capacity / _block_size;
             DBG_PRINTF("Standard Capacity: c_size: %" PRIu32 "\r\n", c_size);
-            DBG_PRINTF("Sectors: 0x%llx : %llu\r\n", blocks, blocks);
-            DBG_PRINTF("Capacity: 0x%llx : %llu MB\r\n", capacity,
+            DBG_PRINTF("Sectors: 0x%" PRIx64 " : %" PRIu64 "\r\n", blocks, blocks);
+            DBG_PRINTF("Capacity: 0x%" PRIx64 " : %" PRIu64 " MB\r\n", capacity,
                        (capacity / (1024U * 1024U)));
             break;
 
@@ -741,8 +770,8 @@ static uint64_t sd_sectors_nolock(sd_card_t *pSD) {
             blocks = (hc_c_size + 1) << 10;  // block count = C_SIZE+1) * 1K
                                              // byte (512B is block size)
             DBG_PRINTF("SDHC/SDXC Card: hc_c_size: %" PRIu32 "\r\n", hc_c_size);
-            DBG_PRINTF("Sectors: %8llu\r\n", blocks);
-            DBG_PRINTF("Capacity: %8llu MB\r\n", (blocks / (2048U)));
+            DBG_PRINTF("Sectors: %8" PRIu64 "\r\n", blocks);
+            DBG_PRINTF("Capacity: %8" PRIu64 " MB\r\n", (blocks / (2048U)));
             break;
 
         default:
@@ -777,6 +806,26 @@ static bool sd_wait_token(sd_card_t *pSD, uint8_t token) {
 #define SPI_START_BLOCK \
     (0xFE) /*!< For Single Block Read/Write and Multiple Block Read */
 
+/* Moves a data block. While CRCs are on, *crc receives the CRC16 of the data
+ * (tx, or rx when tx is NULL): for free from the DMA sniffer, or from the
+ * slice-by-4 table when SD_DMA_CRC is 0. */
+static bool sd_data_transfer(sd_card_t *pSD, const uint8_t *tx, uint8_t *rx,
+                             uint32_t length, uint16_t *crc) {
+#if SD_CRC_ENABLED
+    if (crc_on) {
+#if SD_DMA_CRC
+        return spi_transfer_crc16(pSD->spi, tx, rx, length, crc);
+#else
+        bool ok = sd_spi_transfer(pSD, tx, rx, length);
+        *crc = crc16_slice4(tx ? tx : rx, length);
+        return ok;
+#endif
+    }
+#endif
+    (void)crc;
+    return sd_spi_transfer(pSD, tx, rx, length);
+}
+
 static int sd_read_bytes(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     uint16_t crc;
 
@@ -797,7 +846,7 @@ static int sd_read_bytes(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     if (crc_on) {
         uint32_t crc_result;
         // Compute and verify checksum
-        crc_result = crc16((void *)buffer, length);
+        crc_result = crc16_slice4(buffer, length);
         if ((uint16_t)crc_result != crc) {
             DBG_PRINTF("_read_bytes: Invalid CRC received 0x%" PRIx16
                        " result of computation 0x%" PRIx16 "\r\n",
@@ -811,6 +860,7 @@ static int sd_read_bytes(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
 }
 static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     uint16_t crc;
+    uint16_t crc_result = 0;
 
     // read until start byte (0xFE)
     if (false == sd_wait_token(pSD, SPI_START_BLOCK)) {
@@ -819,19 +869,19 @@ static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     }
     // read data
     // bool spi_transfer(const uint8_t *tx, uint8_t *rx, size_t length)
-    if (!sd_spi_transfer(pSD, NULL, buffer, length)) {
+    LATENCY_BEGIN(start);
+    if (!sd_data_transfer(pSD, NULL, buffer, length, &crc_result)) {
         return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
     }
     // Read the CRC16 checksum for the data block
     crc = (sd_spi_write(pSD, SPI_FILL_CHAR) << 8);
     crc |= sd_spi_write(pSD, SPI_FILL_CHAR);
+    LATENCY_END(LAT_SD_DATA, start);
 
 #if SD_CRC_ENABLED
     if (crc_on) {
-        uint32_t crc_result;
-        // Compute and verify checksum
-        crc_result = crc16((void *)buffer, length);
-        if ((uint16_t)crc_result != crc) {
+        // Verify checksum
+        if (crc_result != crc) {
             DBG_PRINTF("%s: Invalid CRC received 0x%" PRIx16
                        " result of computation 0x%" PRIx16 "\r\n",
                        __FUNCTION__, crc, (uint16_t)crc_result);
@@ -904,25 +954,19 @@ static uint8_t sd_write_block(sd_card_t *pSD, const uint8_t *buffer,
     uint8_t response = 0xFF;
 
     // indicate start of block
+    LATENCY_BEGIN(start);
     sd_spi_write(pSD, token);
 
-    // write the data
-    bool ret = sd_spi_transfer(pSD, buffer, NULL, length);
+    // write the data, computing its CRC on the way
+    bool ret = sd_data_transfer(pSD, buffer, NULL, length, &crc);
     myASSERT(ret);
 
-#if SD_CRC_ENABLED
-    if (crc_on) {
-        // Compute CRC
-        crc = crc16((void *)buffer, length);
-    }
-#endif
-
-    // write the checksum CRC16
-    sd_spi_write(pSD, crc >> 8);
-    sd_spi_write(pSD, crc);
-
-    // check the response token
-    response = sd_spi_write(pSD, SPI_FILL_CHAR);
+    // write the checksum CRC16 and clock in the response token
+    uint8_t tail_tx[3] = {crc >> 8, crc, SPI_FILL_CHAR};
+    uint8_t tail_rx[3];
+    sd_spi_transfer(pSD, tail_tx, tail_rx, sizeof tail_tx);
+    response = tail_rx[2];
+    LATENCY_END(LAT_SD_DATA, start);
 
     // Wait for last block to be written
     if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
@@ -1024,6 +1068,264 @@ int sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     return status;
 }
 
+static uint64_t sd_block_address(sd_card_t *pSD, uint64_t ulSectorNumber) {
+    // SDSC Card (CCS=0) uses byte unit address
+    // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
+    return SDCARD_V2HC == pSD->card_type ? ulSectorNumber : ulSectorNumber * _block_size;
+}
+
+static int in_sd_stream_open(sd_card_t *pSD, uint64_t ulSectorNumber, uint32_t preEraseCnt) {
+    int status;
+    if (pSD->stream_open) sd_stream_stop(pSD);
+    if (preEraseCnt) {
+        // Pre-erase hint for the whole extent; ignored by cards that don't
+        // support it. The count field is 23 bits wide.
+        if (preEraseCnt > 0x7FFFFF) preEraseCnt = 0x7FFFFF;
+        sd_cmd(pSD, ACMD23_SET_WR_BLK_ERASE_COUNT, preEraseCnt, 1, 0);
+        sd_spi_deselect_pulse(pSD);
+    }
+    status = sd_cmd(pSD, CMD25_WRITE_MULTIPLE_BLOCK,
+                    sd_block_address(pSD, ulSectorNumber), false, 0);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) return status;
+    pSD->stream_open = true;
+    pSD->stream_next = ulSectorNumber;
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+/** Open a streaming write session at an LBA
+ *
+ *  @param ulSectorNumber  First block of the session
+ *  @param preEraseCnt     Blocks expected in the session (ACMD23), 0 to skip
+ */
+int sd_stream_begin(sd_card_t *pSD, uint64_t ulSectorNumber, uint32_t preEraseCnt) {
+    if (ulSectorNumber >= pSD->sectors) return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    sd_acquire(pSD);
+    pSD->stream_blocks = 0;
+    pSD->stream_reopens = 0;
+    int status = in_sd_stream_open(pSD, ulSectorNumber, preEraseCnt);
+    sd_release(pSD);
+    return status;
+}
+
+/** Write blocks through the streaming session
+ *
+ *  Blocks that continue the open CMD25 go out with just the data token;
+ *  a write anywhere else reopens the stream at the new LBA.
+ */
+int sd_stream_write(sd_card_t *pSD, const uint8_t *buffer,
+                    uint64_t ulSectorNumber, uint32_t blockCnt) {
+    if (ulSectorNumber + blockCnt > pSD->sectors)
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+
+    int status = SD_BLOCK_DEVICE_ERROR_NONE;
+    sd_acquire(pSD);
+    if (!pSD->stream_open || pSD->stream_stale || pSD->stream_next != ulSectorNumber) {
+        pSD->stream_reopens++;
+        status = in_sd_stream_open(pSD, ulSectorNumber, 0);
+    }
+    while (SD_BLOCK_DEVICE_ERROR_NONE == status && blockCnt--) {
+        uint8_t response = sd_write_block(pSD, buffer, SPI_START_BLK_MUL_WRITE, _block_size);
+        if (response != SPI_DATA_ACCEPTED) {
+            DBG_PRINTF("Stream Block Write failed: 0x%x\r\n", response);
+            sd_stream_stop(pSD);
+            status = SD_BLOCK_DEVICE_ERROR_WRITE;
+            break;
+        }
+        buffer += _block_size;
+        pSD->stream_next++;
+        pSD->stream_blocks++;
+    }
+    sd_release(pSD);
+    return status;
+}
+
+/** Close the streaming session and check the card status */
+int sd_stream_end(sd_card_t *pSD) {
+    int status = SD_BLOCK_DEVICE_ERROR_NONE;
+    sd_acquire(pSD);
+    if (pSD->stream_open) {
+        uint32_t stat = 0;
+        sd_stream_stop(pSD);
+        status = sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
+    }
+    sd_release(pSD);
+    return status;
+}
+
+/* Asynchronous block writes
+ * -------------------------
+ * The command (CMD25) is sent from the caller, then each block runs as a
+ * chain of interrupt handlers:
+ *  - data token, then the 512 data bytes by DMA (the sniffer computes CRC);
+ *  - DMA IRQ: CRC and data response token (polled, 3 bytes);
+ *  - timer alarm every SD_ASYNC_POLL_US: one byte to check whether the card
+ *    is still busy programming, until it releases DO.
+ * The card and its SPI stay acquired (sd_acquire) from submission until the
+ * completion callback, so any synchronous access simply waits for the mutex.
+ * Nothing here waits for the card: on a rejected block, a card stuck busy
+ * or no free alarm the op fails and the stream is only marked stale. The
+ * Stop Tran and the rewrite happen in sd_async_retry(), in task context.
+ */
+#define SD_ASYNC_POLL_US 100
+
+static alarm_pool_t *async_alarm_pool;
+
+/** Alarm pool for the busy polling; its IRQ runs on the core that created it */
+void sd_async_set_alarm_pool(alarm_pool_t *pool) {
+    async_alarm_pool = pool;
+}
+
+static void sd_async_next_block(sd_async_op_t *op);
+
+static void sd_async_finish(sd_async_op_t *op, int status) {
+    sd_card_t *pSD = op->sd;
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) pSD->stream_stale = true;
+    op->status = status;
+    sd_release(pSD);
+    op->done = true;
+    if (op->callback) op->callback(op);
+}
+
+static void sd_async_block_done(sd_async_op_t *op) {
+    sd_card_t *pSD = op->sd;
+    op->buffer += _block_size;
+    pSD->stream_next++;
+    pSD->stream_blocks++;
+    if (--op->remaining) {
+        sd_async_next_block(op);
+    } else {
+        sd_async_finish(op, SD_BLOCK_DEVICE_ERROR_NONE);
+    }
+}
+
+static int64_t sd_async_busy_alarm(alarm_id_t id, void *user_data) {
+    sd_async_op_t *op = (sd_async_op_t *)user_data;
+    if (0x00 != sd_spi_write(op->sd, SPI_FILL_CHAR)) {
+#if LATENCY_STATS
+        latency_record(LAT_SD_BUSY, time_us_32() - op->busy_start_us);
+#endif
+        sd_async_block_done(op);
+        return 0;
+    }
+    if (absolute_time_diff_us(get_absolute_time(), op->busy_deadline) <= 0) {
+        DBG_PRINTF("%s: card stuck busy\r\n", __FUNCTION__);
+        sd_async_finish(op, SD_BLOCK_DEVICE_ERROR_WRITE);
+        return 0;
+    }
+    return SD_ASYNC_POLL_US;  // Re-arm
+}
+
+static void sd_async_data_sent(void *ctx) {
+    sd_async_op_t *op = (sd_async_op_t *)ctx;
+    sd_card_t *pSD = op->sd;
+
+#if SD_CRC_ENABLED
+#if SD_DMA_CRC
+    if (crc_on) op->crc = spi_dma_crc16();
+#else
+    if (crc_on) op->crc = crc16_slice4(op->buffer, _block_size);
+#endif
+#endif
+    uint8_t tail_tx[3] = {op->crc >> 8, op->crc, SPI_FILL_CHAR};
+    uint8_t tail_rx[3];
+    sd_spi_transfer(pSD, tail_tx, tail_rx, sizeof tail_tx);
+    uint8_t response = tail_rx[2] & SPI_DATA_RESPONSE_MASK;
+#if LATENCY_STATS
+    latency_record(LAT_SD_DATA, time_us_32() - op->data_start_us);
+#endif
+    if (response != SPI_DATA_ACCEPTED) {
+        DBG_PRINTF("Async Block Write failed: 0x%x\r\n", response);
+        sd_async_finish(op, SD_BLOCK_DEVICE_ERROR_WRITE);
+        return;
+    }
+    // Short programming times are common: check once before arming the timer
+    if (0x00 != sd_spi_write(pSD, SPI_FILL_CHAR)) {
+        sd_async_block_done(op);
+        return;
+    }
+    op->busy_deadline = make_timeout_time_ms(SD_COMMAND_TIMEOUT);
+#if LATENCY_STATS
+    op->busy_start_us = time_us_32();
+#endif
+    alarm_id_t id = async_alarm_pool
+        ? alarm_pool_add_alarm_in_us(async_alarm_pool, SD_ASYNC_POLL_US, sd_async_busy_alarm, op, true)
+        : add_alarm_in_us(SD_ASYNC_POLL_US, sd_async_busy_alarm, op, true);
+    if (id < 0) {
+        // No alarm slot: leave the wait to sd_async_retry()
+        sd_async_finish(op, SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK);
+    }
+}
+
+static void sd_async_next_block(sd_async_op_t *op) {
+    bool sniff = false;
+    op->crc = 0xFFFF;
+#if SD_CRC_ENABLED
+    sniff = crc_on && SD_DMA_CRC;
+#endif
+#if LATENCY_STATS
+    op->data_start_us = time_us_32();
+#endif
+    sd_spi_write(op->sd, SPI_START_BLK_MUL_WRITE);
+    spi_transfer_async(op->sd->spi, op->buffer, NULL, _block_size, sniff, sd_async_data_sent, op);
+}
+
+/** Start writing blocks without waiting for the card
+ *
+ *  Fill in buffer, ulSectorNumber, blockCnt and optionally callback and
+ *  user_data; the buffer must stay untouched until op->done. Uses the same
+ *  streaming session as sd_stream_write(), so consecutive submissions keep
+ *  one CMD25 open. The callback runs in interrupt context.
+ *
+ *  @return SD_BLOCK_DEVICE_ERROR_NONE if the write was started (the final
+ *          result is then in op->status), or an error and no callback.
+ */
+int sd_write_blocks_async(sd_card_t *pSD, sd_async_op_t *op) {
+    if (!op->blockCnt || op->ulSectorNumber + op->blockCnt > pSD->sectors)
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+
+    sd_acquire(pSD);  // Waits for a previous asynchronous write, if any
+    int status = SD_BLOCK_DEVICE_ERROR_NONE;
+    if (!pSD->stream_open || pSD->stream_stale || pSD->stream_next != op->ulSectorNumber) {
+        pSD->stream_reopens++;
+        status = in_sd_stream_open(pSD, op->ulSectorNumber, 0);
+    }
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+        sd_release(pSD);
+        return status;
+    }
+    op->sd = pSD;
+    op->remaining = op->blockCnt;
+    op->status = SD_BLOCK_DEVICE_ERROR_NONE;
+    op->done = false;
+    sd_async_next_block(op);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+int sd_async_wait(sd_async_op_t *op) {
+    while (!op->done) tight_loop_contents();
+    return op->status;
+}
+
+/** Finish a failed asynchronous write from task context
+ *
+ *  Closes the stale stream and rewrites, through sd_stream_write(), the
+ *  blocks that were not confirmed (the failed one included).
+ *
+ *  @return the new op->status
+ */
+int sd_async_retry(sd_async_op_t *op) {
+    if (!op->done || SD_BLOCK_DEVICE_ERROR_NONE == op->status) return op->status;
+    uint64_t lba = op->ulSectorNumber + (op->blockCnt - op->remaining);
+    op->status = sd_stream_write(op->sd, op->buffer, lba, op->remaining);
+    return op->status;
+}
+
 static int sd_init_medium(sd_card_t *pSD) {
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response, arg;
@@ -1134,8 +1436,11 @@ static bool sd_test_com(sd_card_t *pSD);
 static void sd_ctor(sd_card_t *pSD) {
     // State variables:
     pSD->m_Status = STA_NOINIT;
+    pSD->stream_open = false;
+    pSD->stream_stale = false;
     pSD->init = sd_init;
     pSD->write_blocks = sd_write_blocks;
+    pSD->write_blocks_async = sd_write_blocks_async;
     pSD->read_blocks = sd_read_blocks;
     pSD->sd_test_com = sd_test_com;
 }
@@ -31,6 +31,26 @@ extern "C" {
 #endif
 
 typedef struct sd_card_t sd_card_t;
+typedef struct sd_async_op sd_async_op_t;
+
+// Asynchronous write request (see sd_write_blocks_async)
+typedef void (*sd_async_cb_t)(sd_async_op_t *op);
+struct sd_async_op {
+    const uint8_t *buffer;
+    uint64_t ulSectorNumber;
+    uint32_t blockCnt;
+    sd_async_cb_t callback;     // Called in IRQ context when done; may be NULL
+    void *user_data;
+    volatile int status;        // SD_BLOCK_DEVICE_ERROR_* once done
+    volatile bool done;
+    // Internal state:
+    sd_card_t *sd;
+    uint32_t remaining;
+    uint16_t crc;
+    absolute_time_t busy_deadline;
+    uint32_t data_start_us;     // Latency stats (LATENCY_STATS)
+    uint32_t busy_start_us;
+};
 
 // "Class" representing SD Cards
 struct sd_card_t {
@@ -54,10 +74,17 @@ struct sd_card_t {
     mutex_t mutex;
     FATFS fatfs;
     bool mounted;
+    // Streaming write session: one CMD25 kept open across many calls
+    bool stream_open;
+    uint64_t stream_next;     // LBA expected by the open CMD25
+    uint32_t stream_blocks;   // Blocks written in the current session
+    uint32_t stream_reopens;  // CMD25 reissued because of a seek or another command
+    bool stream_stale;        // An async write failed in IRQ context: stop before reuse
 
     int (*init)(sd_card_t *sd_card_p);
     int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer,
                     uint64_t ulSectorNumber, uint32_t blockCnt);
+    int (*write_blocks_async)(sd_card_t *sd_card_p, sd_async_op_t *op);
     int (*read_blocks)(sd_card_t *sd_card_p, uint8_t *buffer, uint64_t ulSectorNumber,
                     uint32_t ulSectorCount);
 
@@ -93,6 +120,28 @@ uint64_t sd_sectors(sd_card_t *pSD);
 bool sd_init_driver();
 bool sd_card_detect(sd_card_t *sd_card_p);
 
+/* Streaming writes for sequential logging. sd_stream_write() writes at any
+LBA; as long as each call continues where the previous one stopped, the same
+CMD25 stays open and no per-call command is sent. Any other command issued
+to the card (FatFs reads, single writes, status) closes the session first. */
+int sd_stream_begin(sd_card_t *pSD, uint64_t ulSectorNumber, uint32_t preEraseCnt);
+int sd_stream_write(sd_card_t *pSD, const uint8_t *buffer,
+                    uint64_t ulSectorNumber, uint32_t blockCnt);
+int sd_stream_end(sd_card_t *pSD);
+
+/* Non-blocking writes: the token/data/CRC/busy phases run from the SPI DMA
+IRQ and a timer alarm, so the caller keeps running while the card programs
+(often 10-250 ms). Poll op->done, wait with sd_async_wait(), or use the
+callback.
+The IRQ and alarm handlers never wait for the card: a write that cannot
+proceed fails with an error, and the owner finishes it from task context
+with sd_async_retry(). Alarms come from the default pool unless
+sd_async_set_alarm_pool() picks one created on the storage core. */
+int sd_write_blocks_async(sd_card_t *pSD, sd_async_op_t *op);
+int sd_async_wait(sd_async_op_t *op);
+int sd_async_retry(sd_async_op_t *op);
+void sd_async_set_alarm_pool(alarm_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,13 @@ static void in_spi_irq_handler(const uint DMA_IRQ_num, io_rw_32 *dma_hw_ints_p)
             if (*dma_hw_ints_p & (1 << spi_p->rx_dma)) {
                 *dma_hw_ints_p = 1 << spi_p->rx_dma;  // Clear it.
                 assert(!dma_channel_is_busy(spi_p->rx_dma));
+                // Asynchronous transfer: hand over to its owner
+                if (spi_p->dma_done) {
+                    spi_done_cb_t done = spi_p->dma_done;
+                    spi_p->dma_done = NULL;
+                    done(spi_p->dma_done_ctx);
+                    continue;
+                }
                 assert(!sem_available(&spi_p->sem));
                 bool ok = sem_release(&spi_p->sem);
                 assert(ok);
@@ -54,15 +61,33 @@ void set_spi_dma_irq_channel(bool useChannel1, bool shared) {
     irqShared = shared;
 }
 
-// SPI Transfer: Read & Write (simultaneously) on SPI bus
-//   If the data that will be received is not important, pass NULL as rx.
-//   If the data that will be transmitted is not important,
-//     pass NULL as tx and then the SPI_FILL_CHAR is sent out as each data
-//     element.
-bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
-    // assert(512 == length || 1 == length);
-    assert(tx || rx);
-    // assert(!(tx && rx));
+// Short transfers: a DMA setup, semaphore reset and IRQ round trip cost
+// more than clocking a few bytes through the FIFOs directly.
+static bool __not_in_flash_func(spi_transfer_polled)(spi_t *spi_p, const uint8_t *tx,
+                                                     uint8_t *rx, size_t length) {
+    int num;
+    if (tx && rx) {
+        num = spi_write_read_blocking(spi_p->hw_inst, tx, rx, length);
+    } else if (tx) {
+        num = spi_write_blocking(spi_p->hw_inst, tx, length);
+    } else {
+        num = spi_read_blocking(spi_p->hw_inst, SPI_FILL_CHAR, rx, length);
+    }
+    return (size_t)num == length;
+}
+
+// Configures both DMA channels and starts them; completion is signalled by
+// the rx channel's IRQ. With crc16, the DMA sniffer computes the CRC-16-CCITT
+// of the outgoing data (or of the incoming data if tx is NULL) as it moves.
+static void __not_in_flash_func(spi_dma_start)(spi_t *spi_p, const uint8_t *tx, uint8_t *rx,
+                                               size_t length, bool crc16) {
+    channel_config_set_sniff_enable(&spi_p->tx_dma_cfg, crc16 && tx);
+    channel_config_set_sniff_enable(&spi_p->rx_dma_cfg, crc16 && !tx);
+    if (crc16) {
+        dma_sniffer_enable(tx ? spi_p->tx_dma : spi_p->rx_dma,
+                           DMA_SNIFF_CTRL_CALC_VALUE_CRC16, true);
+        dma_sniffer_set_data_accumulator(0);
+    }
 
     // tx write increment is already false
     if (tx) {
@@ -105,11 +130,16 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
         default:
             assert(false);
     }
-    sem_reset(&spi_p->sem, 0);
 
     // start them exactly simultaneously to avoid races (in extreme cases
     // the FIFO could overflow)
     dma_start_channel_mask((1u << spi_p->tx_dma) | (1u << spi_p->rx_dma));
+}
+
+static bool __not_in_flash_func(spi_transfer_dma)(spi_t *spi_p, const uint8_t *tx, uint8_t *rx,
+                                                   size_t length, bool crc16) {
+    sem_reset(&spi_p->sem, 0);
+    spi_dma_start(spi_p, tx, rx, length, crc16);
 
     /* Wait until master completes transfer or time out has occured. */
     uint32_t timeOut = 1000; /* Timeout 1 sec */
@@ -131,6 +161,58 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     return true;
 }
 
+// SPI Transfer: Read & Write (simultaneously) on SPI bus
+//   If the data that will be received is not important, pass NULL as rx.
+//   If the data that will be transmitted is not important,
+//     pass NULL as tx and then the SPI_FILL_CHAR is sent out as each data
+//     element.
+bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
+    // assert(512 == length || 1 == length);
+    assert(tx || rx);
+    // assert(!(tx && rx));
+
+    if (length < spi_p->polled_threshold)
+        return spi_transfer_polled(spi_p, tx, rx, length);
+    return spi_transfer_dma(spi_p, tx, rx, length, false);
+}
+
+// As spi_transfer, always by DMA, also returning the CRC-16-CCITT of tx (or
+// of rx if tx is NULL) computed by the DMA sniffer at no CPU cost.
+bool spi_transfer_crc16(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length,
+                        uint16_t *crc) {
+    assert(tx || rx);
+    bool ok = spi_transfer_dma(spi_p, tx, rx, length, true);
+    *crc = spi_dma_crc16();
+    return ok;
+}
+
+// Result of the last transfer started with crc16 set
+uint16_t spi_dma_crc16(void) {
+    return (uint16_t)dma_sniffer_get_data_accumulator();
+}
+
+// Starts a DMA transfer and returns at once; done(ctx) is called from the
+// DMA IRQ when the last byte has been received. The caller must own the SPI
+// (spi_lock) until then. With crc16, read the result with spi_dma_crc16().
+void spi_transfer_async(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length,
+                        bool crc16, spi_done_cb_t done, void *ctx) {
+    assert(tx || rx);
+    assert(!spi_p->dma_done);
+    spi_p->dma_done_ctx = ctx;
+    spi_p->dma_done = done;
+    spi_dma_start(spi_p, tx, rx, length, crc16);
+}
+
+// Enables or disables the DMA IRQ of every initialized SPI on the calling
+// core. The NVIC is per core: to have the IRQ serviced on another core, call
+// with false on the core that ran my_spi_init() and with true on the new one.
+void my_spi_set_irq_enabled(bool enabled) {
+    for (size_t i = 0; i < spi_get_num(); ++i) {
+        spi_t *spi_p = spi_get_by_num(i);
+        if (spi_p->initialized) irq_set_enabled(spi_p->DMA_IRQ_num, enabled);
+    }
+}
+
 void spi_lock(spi_t *spi_p) {
     assert(mutex_is_initialized(&spi_p->mutex));
     mutex_enter_blocking(&spi_p->mutex);
@@ -153,6 +235,8 @@ bool my_spi_init(spi_t *spi_p) {
         // Default:
         if (!spi_p->baud_rate)
             spi_p->baud_rate = 10 * 1000 * 1000;
+        if (!spi_p->polled_threshold)
+            spi_p->polled_threshold = SPI_POLLED_THRESHOLD;
         // For the IRQ notification:
         sem_init(&spi_p->sem, 0, 1);
 
@@ -27,6 +27,14 @@ specific language governing permissions and limitations under the License.
 
 #define SPI_FILL_CHAR (0xFF)
 
+// Transfers shorter than this many bytes are done by polling the SPI FIFOs
+// instead of setting up DMA: command packets, response and busy polling.
+#ifndef SPI_POLLED_THRESHOLD
+#define SPI_POLLED_THRESHOLD 32
+#endif
+
+typedef void (*spi_done_cb_t)(void *ctx);
+
 // "Class" representing SPIs
 typedef struct {
     // SPI HW
@@ -36,6 +44,7 @@ typedef struct {
     uint sck_gpio;
     uint baud_rate;
     uint DMA_IRQ_num; // DMA_IRQ_0 or DMA_IRQ_1
+    uint polled_threshold; // 0: SPI_POLLED_THRESHOLD; 1: always use DMA
 
     // Drive strength levels for GPIO outputs.
     // enum gpio_drive_strength { GPIO_DRIVE_STRENGTH_2MA = 0, GPIO_DRIVE_STRENGTH_4MA = 1, GPIO_DRIVE_STRENGTH_8MA = 2,
@@ -53,6 +62,8 @@ typedef struct {
     bool initialized;  
     semaphore_t sem;
     mutex_t mutex;    
+    volatile spi_done_cb_t dma_done; // Set while an async transfer is in flight
+    void *dma_done_ctx;
 } spi_t;
 
 #ifdef __cplusplus
@@ -60,10 +71,16 @@ extern "C" {
 #endif
   
 bool __not_in_flash_func(spi_transfer)(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length);  
+bool spi_transfer_crc16(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length,
+                        uint16_t *crc);
+void spi_transfer_async(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length,
+                        bool crc16, spi_done_cb_t done, void *ctx);
+uint16_t spi_dma_crc16(void);
 void spi_lock(spi_t *pSPI);
 void spi_unlock(spi_t *pSPI);
 bool my_spi_init(spi_t *pSPI);
 void set_spi_dma_irq_channel(bool useChannel1, bool shared);
+void my_spi_set_irq_enabled(bool enabled);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "sd_spi.h"
+#include "crc.h"
+#include "log_format.h"
+#include "log_writer.h"
+#include "bench.h"
+#include "font.h"
+
+#define BENCH_CRC_BLOCK 512
+
+// Tempo médio por iteração em nanossegundos
+static uint32_t bench_per_iter_ns(uint64_t start_us, int iterations) {
+    return (uint32_t)((time_us_64() - start_us) * 1000 / iterations);
+}
+
+static uint32_t bench_cmd13(sd_card_t *sd, int iterations) {
+    uint64_t start = time_us_64();
+    for (int i = 0; i < iterations; i++) sd->sd_test_com(sd);
+    return bench_per_iter_ns(start, iterations);
+}
+
+static uint32_t bench_spi_byte(sd_card_t *sd, int iterations) {
+    sd_spi_acquire(sd);
+    uint64_t start = time_us_64();
+    for (int i = 0; i < iterations; i++) sd_spi_write(sd, SPI_FILL_CHAR);
+    uint32_t ns = bench_per_iter_ns(start, iterations);
+    sd_spi_release(sd);
+    return ns;
+}
+
+static void bench_print(const char *name, uint32_t before_ns, uint32_t after_ns) {
+    printf("%s: %lu.%03lu us (DMA) -> %lu.%03lu us (polling)\n", name,
+           before_ns / 1000, before_ns % 1000, after_ns / 1000, after_ns % 1000);
+}
+
+void bench_sd_command_latency(sd_card_t *sd, int iterations) {
+    spi_t *spi = sd->spi;
+    uint saved = spi->polled_threshold;
+
+    spi->polled_threshold = 1;  // Toda transferência por DMA
+    uint32_t cmd_dma = bench_cmd13(sd, iterations);
+    uint32_t byte_dma = bench_spi_byte(sd, iterations);
+
+    spi->polled_threshold = saved;
+    uint32_t cmd_polled = bench_cmd13(sd, iterations);
+    uint32_t byte_polled = bench_spi_byte(sd, iterations);
+
+    printf("Bench SD (%d iteracoes, limiar de polling %u bytes)\n", iterations, saved);
+    bench_print("  CMD13", cmd_dma, cmd_polled);
+    bench_print("  Byte SPI", byte_dma, byte_polled);
+}
+
+// Canal DMA memória -> endereço fixo, só para alimentar o sniffer
+static uint32_t bench_crc_dma(const uint8_t *block, int iterations, uint16_t *crc) {
+    int ch = dma_claim_unused_channel(false);
+    if (ch < 0) return 0;
+    static uint8_t sink;
+    dma_channel_config cfg = dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_sniff_enable(&cfg, true);
+    dma_sniffer_enable(ch, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, true);
+
+    uint64_t start = time_us_64();
+    for (int i = 0; i < iterations; i++) {
+        dma_sniffer_set_data_accumulator(0);
+        dma_channel_configure(ch, &cfg, &sink, block, BENCH_CRC_BLOCK, true);
+        dma_channel_wait_for_finish_blocking(ch);
+        *crc = (uint16_t)dma_sniffer_get_data_accumulator();
+    }
+    uint32_t ns = bench_per_iter_ns(start, iterations);
+    dma_sniffer_disable();
+    dma_channel_unclaim(ch);
+    return ns;
+}
+
+void bench_crc16(int iterations) {
+    static uint8_t block[BENCH_CRC_BLOCK];
+    for (int i = 0; i < BENCH_CRC_BLOCK; i++) block[i] = (uint8_t)(i * 37 + 11);
+    volatile uint16_t sink;
+
+    uint64_t start = time_us_64();
+    for (int i = 0; i < iterations; i++) sink = crc16((const char *)block, BENCH_CRC_BLOCK);
+    uint32_t table_ns = bench_per_iter_ns(start, iterations);
+    uint16_t ref = sink;
+
+    start = time_us_64();
+    for (int i = 0; i < iterations; i++) sink = crc16_slice4(block, BENCH_CRC_BLOCK);
+    uint32_t slice_ns = bench_per_iter_ns(start, iterations);
+    uint16_t slice = sink;
+
+    uint16_t dma = 0;
+    uint32_t dma_ns = bench_crc_dma(block, iterations, &dma);
+
+    printf("Bench CRC16 (bloco de %d bytes, %d iteracoes)\n", BENCH_CRC_BLOCK, iterations);
+    printf("  Tabela 1 byte: %lu.%03lu us\n", table_ns / 1000, table_ns % 1000);
+    printf("  Slice-by-4:    %lu.%03lu us %s\n", slice_ns / 1000, slice_ns % 1000,
+           slice == ref ? "" : "(CRC DIVERGENTE)");
+    printf("  Sniffer DMA:   %lu.%03lu us %s\n", dma_ns / 1000, dma_ns % 1000,
+           dma == ref ? "" : "(CRC DIVERGENTE)");
+}
+
+// --- RELATÓRIO COMPLETO (STATE_BENCHMARK) ---
+
+#define BENCH_SD_MIN_CHUNK   512
+#define BENCH_SD_MAX_CHUNK   (64 * 1024)
+#define BENCH_SD_BYTES       (256 * 1024) // Volume por tamanho de bloco
+#define BENCH_SD_MIN_WRITES  16
+#define BENCH_SD_MAX_WRITES  256
+#define BENCH_SD_TMP_FILE    "bench.tmp"
+#define BENCH_I2C_READS      200
+#define BENCH_FORMAT_ITERS   1000
+#define BENCH_OLED_FRAMES    20
+#define BENCH_DRAW_ITERS     50
+#define BENCH_REPORT_SIZE    3072
+
+static char bench_report[BENCH_REPORT_SIZE];
+static uint32_t bench_report_len;
+static uint32_t bench_lat_us[BENCH_SD_MAX_WRITES];
+
+// Cada linha vai para o USB e para o texto do relatório, gravado no fim
+// para não interferir nas medições do cartão
+static void bench_out(const char *fmt, ...) {
+    char line[96];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    printf("%s", line);
+    if (bench_report_len + len <= sizeof(bench_report)) {
+        memcpy(bench_report + bench_report_len, line, len);
+        bench_report_len += len;
+    }
+}
+
+static int bench_cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentil p (0-100) de uma lista já ordenada
+static uint32_t bench_percentile(const uint32_t *sorted, int n, int p) {
+    int i = (n * p + 99) / 100 - 1;
+    if (i < 0) i = 0;
+    return sorted[i];
+}
+
+// Quadros reais da rajada da FIFO, reaproveitados como entrada do codificador
+static mpu6050_frame_t bench_frames[MPU6050_FIFO_BURST_FRAMES];
+static int bench_n_frames;
+
+static void bench_report_i2c(mpu6050_t *imu, bench_result_t *r) {
+    int16_t accel[3], gyro[3];
+    uint32_t max_us = 0;
+    uint64_t start = time_us_64();
+    for (int i = 0; i < BENCH_I2C_READS; i++) {
+        uint64_t t0 = time_us_64();
+        mpu6050_read_raw(imu, accel, gyro);
+        uint32_t dt = (uint32_t)(time_us_64() - t0);
+        if (dt > max_us) max_us = dt;
+    }
+    r->imu_read_ns = bench_per_iter_ns(start, BENCH_I2C_READS);
+    bench_out("Leitura I2C (14 bytes): media %lu.%03lu us, max %lu us\n",
+              r->imu_read_ns / 1000, r->imu_read_ns % 1000, max_us);
+
+    // Rajada da FIFO: custo por quadro com a fila do sensor cheia
+    mpu6050_fifo_enable(imu);
+    absolute_time_t deadline = make_timeout_time_ms(1000);
+    while (mpu6050_fifo_count(imu) < MPU6050_FIFO_BURST_BYTES &&
+           absolute_time_diff_us(get_absolute_time(), deadline) > 0)
+        sleep_ms(5);
+    start = time_us_64();
+    int n = mpu6050_fifo_read(imu, bench_frames, MPU6050_FIFO_BURST_FRAMES);
+    uint32_t burst_us = (uint32_t)(time_us_64() - start);
+    mpu6050_fifo_disable(imu);
+    r->fifo_frame_ns = n > 0 ? burst_us * 1000 / n : 0;
+    bench_n_frames = n > 0 ? n : 0;
+    bench_out("Rajada FIFO: %d quadros em %lu us (%lu.%03lu us/quadro)\n", n, burst_us,
+              r->fifo_frame_ns / 1000, r->fifo_frame_ns % 1000);
+}
+
+// Codificação em blocos sobre os quadros da FIFO (o sensor parado na
+// bancada, como na gravação), em ciclos por amostra e taxa de compressão.
+// Sem quadros, usa uma amostra fixa com ruído de poucos LSB.
+static void bench_report_format(bench_result_t *r) {
+    static imu_sample_t samples[MPU6050_FIFO_BURST_FRAMES];
+    static log_encoder_t enc;
+    int n = bench_n_frames ? bench_n_frames : MPU6050_FIFO_BURST_FRAMES;
+    for (int i = 0; i < n; i++) {
+        for (int a = 0; a < 3; a++) {
+            if (bench_n_frames) {
+                samples[i].accel[a] = bench_frames[i].accel[a];
+                samples[i].gyro[a] = bench_frames[i].gyro[a];
+            } else {
+                samples[i].accel[a] = (a == 2 ? 16384 : 0) + (i * 7 + a) % 9 - 4;
+                samples[i].gyro[a] = (i * 5 + a) % 7 - 3;
+            }
+        }
+    }
+    imu_sample_t sample = samples[0];
+    const uint8_t *block;
+    char line[64];
+    volatile uint32_t sink = 0;
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+
+    // Amostras consecutivas a 1 kHz, com o bloco final incluído
+    log_encoder_reset(&enc);
+    uint64_t start = time_us_64();
+    for (int i = 0; i < BENCH_FORMAT_ITERS; i++) {
+        const imu_sample_t *src = &samples[i % n];
+        memcpy(sample.accel, src->accel, sizeof(sample.accel));
+        memcpy(sample.gyro, src->gyro, sizeof(sample.gyro));
+        sample.seq = i;
+        sample.timestamp_us += 1000;
+        sink += log_encode(&enc, &sample, &block);
+    }
+    sink += log_encoder_flush(&enc, &block);
+    r->pack_ns = bench_per_iter_ns(start, BENCH_FORMAT_ITERS);
+    r->pack_cycles = r->pack_ns * mhz / 1000;
+    r->pack_bytes_x100 = (uint32_t)((uint64_t)enc.bytes * 100 / enc.samples);
+    uint32_t ratio = LOG_RAW_SAMPLE_SIZE * 10000 / r->pack_bytes_x100;
+    bench_out("Codificacao: %lu ciclos/amostra, %lu.%02lu bytes/amostra (%lu.%02lu:1 sobre %d), %s\n",
+              r->pack_cycles, r->pack_bytes_x100 / 100, r->pack_bytes_x100 % 100,
+              ratio / 100, ratio % 100, LOG_RAW_SAMPLE_SIZE,
+              bench_n_frames ? "quadros da FIFO" : "amostra sintetica");
+
+    start = time_us_64();
+    for (int i = 0; i < BENCH_FORMAT_ITERS; i++) {
+        sink += sprintf(line, "%lu,%d,%d,%d,%d,%d,%d,%llu\n", (uint32_t)i,
+                        sample.accel[0], sample.accel[1], sample.accel[2],
+                        sample.gyro[0], sample.gyro[1], sample.gyro[2], sample.timestamp_us);
+    }
+    r->csv_ns = bench_per_iter_ns(start, BENCH_FORMAT_ITERS);
+    bench_out("Formatacao: binario %lu.%03lu us, CSV %lu.%03lu us por amostra\n",
+              r->pack_ns / 1000, r->pack_ns % 1000, r->csv_ns / 1000, r->csv_ns % 1000);
+}
+
+// Escrita sequencial com f_write em um arquivo temporário, um tamanho de
+// bloco por vez; a latência de cada chamada entra nos percentis
+static FRESULT bench_report_sd(bench_result_t *r) {
+    uint32_t max_chunk = BENCH_SD_MAX_CHUNK;
+    uint8_t *buf = NULL;
+    while (max_chunk >= BENCH_SD_MIN_CHUNK && !(buf = malloc(max_chunk))) max_chunk /= 2;
+    if (!buf) return FR_NOT_ENOUGH_CORE;
+    for (uint32_t i = 0; i < max_chunk; i++) buf[i] = (uint8_t)i;
+
+    FIL fil;
+    FRESULT fr = f_open(&fil, BENCH_SD_TMP_FILE, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fr != FR_OK) {
+        free(buf);
+        return fr;
+    }
+    bench_out("Escrita SD (f_write sequencial):\n");
+    bench_out("  bloco    KB/s    p50    p90    p99    max (us)\n");
+    for (uint32_t chunk = BENCH_SD_MIN_CHUNK; chunk <= max_chunk && fr == FR_OK; chunk *= 2) {
+        int n = BENCH_SD_BYTES / chunk;
+        if (n < BENCH_SD_MIN_WRITES) n = BENCH_SD_MIN_WRITES;
+        if (n > BENCH_SD_MAX_WRITES) n = BENCH_SD_MAX_WRITES;
+        // Recomeça do zero para que todo tamanho aloque clusters novos
+        fr = f_lseek(&fil, 0);
+        if (fr == FR_OK) fr = f_truncate(&fil);
+        if (fr == FR_OK) fr = f_sync(&fil);
+
+        uint64_t start = time_us_64();
+        for (int i = 0; i < n && fr == FR_OK; i++) {
+            UINT bw;
+            uint64_t t0 = time_us_64();
+            fr = f_write(&fil, buf, chunk, &bw);
+            bench_lat_us[i] = (uint32_t)(time_us_64() - t0);
+            if (fr == FR_OK && bw != chunk) fr = FR_DENIED;  // Cartão cheio
+        }
+        if (fr == FR_OK) fr = f_sync(&fil);
+        if (fr != FR_OK) break;
+        uint32_t total_us = (uint32_t)(time_us_64() - start);
+        uint32_t kbps = (uint32_t)((uint64_t)chunk * n * 1000 / 1024 * 1000 / total_us);
+
+        qsort(bench_lat_us, n, sizeof(bench_lat_us[0]), bench_cmp_u32);
+        uint32_t max_us = bench_lat_us[n - 1];
+        bench_out("  %5lu  %6lu %6lu %6lu %6lu %6lu\n", chunk, kbps,
+                  bench_percentile(bench_lat_us, n, 50), bench_percentile(bench_lat_us, n, 90),
+                  bench_percentile(bench_lat_us, n, 99), max_us);
+        // Referência para a taxa sustentável: o tamanho usado pelo gravador
+        if (chunk == LOG_WRITER_BUF_SIZE) {
+            r->sd_kbps = kbps;
+            r->sd_max_latency_us = max_us;
+        }
+    }
+    f_close(&fil);
+    f_unlink(BENCH_SD_TMP_FILE);
+    free(buf);
+    return fr;
+}
+
+// Tela de update_display durante a gravação, desenhada como as primitivas
+// faziam antes (um ssd1306_pixel por pixel) e com as primitivas por bytes
+static void bench_char_pixelwise(ssd1306_t *disp, char c, uint8_t x, uint8_t y) {
+    const uint8_t *glyph = &font[(c >= ' ' && c <= '~' ? c - ' ' : 0) * 8];
+    for (uint8_t i = 0; i < 8; ++i)
+        for (uint8_t j = 0; j < 8; ++j)
+            ssd1306_pixel(disp, x + i, y + j, glyph[i] & (1 << j));
+}
+
+// Mesma quebra de linha de ssd1306_draw_string
+static void bench_string_pixelwise(ssd1306_t *disp, const char *str, uint8_t x, uint8_t y) {
+    while (*str) {
+        bench_char_pixelwise(disp, *str++, x, y);
+        x += 8;
+        if (x + 8 >= disp->width) {
+            x = 0;
+            y += 8;
+        }
+        if (y + 8 >= disp->height) break;
+    }
+}
+
+static void bench_draw_pixelwise(ssd1306_t *disp, const char *const *text) {
+    for (uint8_t y = 0; y < disp->height; ++y)
+        for (uint8_t x = 0; x < disp->width; ++x)
+            ssd1306_pixel(disp, x, y, false);
+    bench_string_pixelwise(disp, text[0], 0, 0);
+    for (uint8_t x = 0; x < disp->width; ++x) ssd1306_pixel(disp, x, 10, true);
+    bench_string_pixelwise(disp, text[1], 0, 20);
+    bench_string_pixelwise(disp, text[2], 0, 32);
+    bench_string_pixelwise(disp, text[3], 0, 48);
+}
+
+static void bench_draw_bytes(ssd1306_t *disp, const char *const *text) {
+    ssd1306_fill(disp, 0);
+    ssd1306_draw_string(disp, text[0], 0, 0);
+    ssd1306_line(disp, 0, 10, 128, 10, true);
+    ssd1306_draw_string(disp, text[1], 0, 20);
+    ssd1306_draw_string(disp, text[2], 0, 32);
+    ssd1306_draw_string(disp, text[3], 0, 48);
+}
+
+// Ciclos de CPU por tela, a partir do tempo médio e do clock do sistema.
+// Os dois desenhos devem produzir o mesmo buffer.
+static void bench_report_draw(ssd1306_t *disp, bench_result_t *r) {
+    static const char *const text[4] = { "Datalogger MPU6050", "Status:", "Gravando...", "Amostras: 123456" };
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    uint8_t *ref = malloc(disp->bufsize);
+
+    uint64_t start = time_us_64();
+    for (int i = 0; i < BENCH_DRAW_ITERS; i++) bench_draw_pixelwise(disp, text);
+    r->draw_pixel_cycles = bench_per_iter_ns(start, BENCH_DRAW_ITERS) * mhz / 1000;
+    if (ref) memcpy(ref, disp->ram_buffer, disp->bufsize);
+
+    start = time_us_64();
+    for (int i = 0; i < BENCH_DRAW_ITERS; i++) bench_draw_bytes(disp, text);
+    r->draw_cycles = bench_per_iter_ns(start, BENCH_DRAW_ITERS) * mhz / 1000;
+
+    bool same = !ref || memcmp(ref, disp->ram_buffer, disp->bufsize) == 0;
+    free(ref);
+    bench_out("Desenho da tela: %lu ciclos pixel a pixel -> %lu ciclos por bytes %s\n",
+              r->draw_pixel_cycles, r->draw_cycles, same ? "" : "(TELA DIVERGENTE)");
+}
+
+// Quadro inteiro e envio parcial com só um contador mudando, como durante
+// a gravação; o wait conta até o último byte sair
+static void bench_report_oled(ssd1306_t *disp, bench_result_t *r) {
+    uint64_t start = time_us_64();
+    for (int i = 0; i < BENCH_OLED_FRAMES; i++) {
+        ssd1306_fill(disp, i & 1);
+        ssd1306_send_data_full(disp);
+        ssd1306_wait(disp);
+    }
+    r->oled_frame_us = (uint32_t)((time_us_64() - start) / BENCH_OLED_FRAMES);
+
+    char counter[8];
+    ssd1306_fill(disp, 0);
+    ssd1306_send_data_full(disp);
+    ssd1306_wait(disp);
+    start = time_us_64();
+    for (int i = 0; i < BENCH_OLED_FRAMES; i++) {
+        sprintf(counter, "%05d", i * 7);
+        ssd1306_draw_string(disp, counter, 0, 48);
+        ssd1306_send_data(disp);
+        ssd1306_wait(disp);
+    }
+    r->oled_partial_us = (uint32_t)((time_us_64() - start) / BENCH_OLED_FRAMES);
+    bench_out("Quadro OLED: %lu us inteiro, %lu us so o contador (%s)\n", r->oled_frame_us,
+              r->oled_partial_us, disp->dma ? "DMA" : "bloqueante");
+}
+
+// Cada estágio limita a taxa: o barramento do sensor, a vazão do cartão no
+// tamanho de lote do gravador e a fila do amostrador, que precisa absorver
+// a pior latência do cartão
+static void bench_report_rate(bench_result_t *r) {
+    uint32_t i2c_ns = r->fifo_frame_ns ? r->fifo_frame_ns : r->imu_read_ns;
+    uint32_t i2c_hz = i2c_ns ? 1000000000u / i2c_ns : 0;
+    uint32_t sd_hz = r->pack_bytes_x100 ?
+        (uint32_t)((uint64_t)r->sd_kbps * 1024 * 100 / r->pack_bytes_x100) : 0;
+    uint32_t ring_hz = r->sd_max_latency_us ?
+        (uint32_t)((uint64_t)SAMPLER_RING_LEN * 1000000 / r->sd_max_latency_us) : 0;
+    const char *limit = "I2C";
+    r->max_rate_hz = i2c_hz;
+    if (sd_hz && sd_hz < r->max_rate_hz) {
+        r->max_rate_hz = sd_hz;
+        limit = "vazao do SD";
+    }
+    if (ring_hz && ring_hz < r->max_rate_hz) {
+        r->max_rate_hz = ring_hz;
+        limit = "fila x latencia do SD";
+    }
+    bench_out("Limites: I2C %lu Hz, SD %lu Hz, fila %lu Hz\n", i2c_hz, sd_hz, ring_hz);
+    bench_out("Taxa sustentavel estimada: %lu Hz (limitada por %s; motor ate %d Hz)\n",
+              r->max_rate_hz, limit, SAMPLER_MAX_ODR_HZ);
+}
+
+FRESULT bench_run_report(const char *path, mpu6050_t *imu, ssd1306_t *disp, bench_result_t *r) {
+    memset(r, 0, sizeof(*r));
+    bench_report_len = 0;
+    bench_out("Relatorio de desempenho do datalogger\n");
+    bench_out("Clock %lu MHz, blocos de %d amostras, lote de %d bytes\n",
+              clock_get_hz(clk_sys) / 1000000, LOG_BLOCK_SAMPLES, LOG_WRITER_BUF_SIZE);
+
+    bench_report_i2c(imu, r);
+    bench_report_format(r);
+    FRESULT fr = bench_report_sd(r);
+    if (fr != FR_OK) bench_out("Escrita SD interrompida: erro %d\n", fr);
+    bench_report_draw(disp, r);
+    bench_report_oled(disp, r);
+    bench_report_rate(r);
+
+    FIL fil;
+    FRESULT wr = f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE);
+    if (wr == FR_OK) {
+        UINT bw;
+        wr = f_write(&fil, bench_report, bench_report_len, &bw);
+        FRESULT cr = f_close(&fil);
+        if (wr == FR_OK) wr = cr;
+    }
+    return fr != FR_OK ? fr : wr;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include "ff.h"
+#include "sd_card.h"
+#include "mpu6050.h"
+#include "ssd1306.h"
+
+// Medições de desempenho executadas sob demanda (RUN_BENCHMARKS). Os
+// resultados saem pelo printf, em microssegundos com três casas decimais.
+
+// Latência de um comando curto do cartão (CMD13) e de um byte avulso no
+// SPI, primeiro só com DMA (comportamento anterior) e depois com o caminho
+// por polling para transferências curtas.
+void bench_sd_command_latency(sd_card_t *sd, int iterations);
+
+// CRC16 de um bloco de 512 bytes: tabela byte a byte (crc16), slice-by-4 e
+// sniffer do DMA (o tempo do sniffer é o da própria cópia por DMA, que na
+// gravação já acontece de qualquer forma). Acusa divergência entre eles.
+void bench_crc16(int iterations);
+
+// Resultados principais do relatório, em ns ou us conforme o campo
+typedef struct {
+    uint32_t imu_read_ns;        // Leitura avulsa de uma amostra (14 bytes)
+    uint32_t fifo_frame_ns;      // Custo por quadro numa rajada da FIFO
+    uint32_t pack_ns, csv_ns;    // Formatação de uma amostra
+    uint32_t pack_cycles;        // Codificação em blocos, ciclos por amostra
+    uint32_t pack_bytes_x100;    // Bytes por amostra codificada (centésimos)
+    uint32_t sd_kbps;            // Vazão com blocos de LOG_WRITER_BUF_SIZE
+    uint32_t sd_max_latency_us;  // Pior f_write nesse tamanho
+    uint32_t draw_pixel_cycles;  // Desenho da tela de gravação pixel a pixel
+    uint32_t draw_cycles;        // A mesma tela com as primitivas por bytes
+    uint32_t oled_frame_us;      // Envio de um quadro completo do display
+    uint32_t oled_partial_us;    // Envio parcial com só um contador alterado
+    uint32_t max_rate_hz;        // Taxa de amostragem sustentável estimada
+} bench_result_t;
+
+// Mede leitura do sensor, formatação, escrita sequencial no SD (vazão e
+// percentis de latência de 512 B a 64 KB), desenho e quadro do display e a taxa
+// sustentável; imprime no USB e grava o texto em 'path'. O amostrador deve
+// estar parado e o volume montado. Usa até 64 KB de heap durante a medição.
+FRESULT bench_run_report(const char *path, mpu6050_t *imu, ssd1306_t *disp, bench_result_t *r);
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "crc.h"
+#include "config_store.h"
+
+#define PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+static const uint8_t *slot_addr(uint16_t slot) {
+    return (const uint8_t *)(XIP_BASE + CONFIG_STORE_OFFSET + (uint32_t)slot * FLASH_PAGE_SIZE);
+}
+
+// CRC de 'len', 'seq' e das entradas, contíguos na página
+static uint16_t page_crc(const config_store_page_t *p) {
+    return crc16_slice4(&p->len, sizeof(p->len) + sizeof(p->seq) + p->len);
+}
+
+static bool slot_blank(uint16_t slot) {
+    const uint32_t *w = (const uint32_t *)slot_addr(slot);
+    for (uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++)
+        if (w[i] != 0xFFFFFFFFu) return false;
+    return true;
+}
+
+bool config_store_load(config_store_t *cs) {
+    memset(cs, 0, sizeof(*cs));
+    for (uint16_t slot = 0; slot < CONFIG_STORE_SLOTS; slot++) {
+        const config_store_page_t *p = (const config_store_page_t *)slot_addr(slot);
+        if (p->magic != CONFIG_STORE_MAGIC) continue;
+        if (p->len > CONFIG_STORE_DATA_MAX || p->crc != page_crc(p)) {
+            cs->bad_pages++;
+            continue;
+        }
+        if (p->seq > cs->seq) {
+            cs->seq = p->seq;
+            cs->slot = slot;
+        }
+    }
+    if (!cs->seq) return false;
+    const config_store_page_t *p = (const config_store_page_t *)slot_addr(cs->slot);
+    cs->len = p->len;
+    memcpy(cs->data, p + 1, p->len);
+    return true;
+}
+
+// Posição da entrada da chave na cópia em RAM (-1: ausente)
+static int find_entry(const config_store_t *cs, uint8_t key) {
+    for (int i = 0; i + 2 <= cs->len; i += 2 + cs->data[i + 1])
+        if (cs->data[i] == key) return i;
+    return -1;
+}
+
+bool config_store_get(const config_store_t *cs, uint8_t key, void *value, size_t size) {
+    int i = find_entry(cs, key);
+    if (i < 0 || cs->data[i + 1] != size) return false;
+    memcpy(value, &cs->data[i + 2], size);
+    return true;
+}
+
+bool config_store_remove(config_store_t *cs, uint8_t key) {
+    int i = find_entry(cs, key);
+    if (i < 0) return false;
+    int old = 2 + cs->data[i + 1];
+    memmove(&cs->data[i], &cs->data[i + old], cs->len - i - old);
+    cs->len -= old;
+    return true;
+}
+
+bool config_store_set(config_store_t *cs, uint8_t key, const void *value, size_t size) {
+    int i = find_entry(cs, key);
+    int old = i < 0 ? 0 : 2 + cs->data[i + 1];
+    if (size > UINT8_MAX || cs->len - old + 2 + size > CONFIG_STORE_DATA_MAX) return false;
+    // Tira a entrada antiga e acrescenta a nova no fim
+    config_store_remove(cs, key);
+    cs->data[cs->len] = key;
+    cs->data[cs->len + 1] = (uint8_t)size;
+    memcpy(&cs->data[cs->len + 2], value, size);
+    cs->len += 2 + size;
+    return true;
+}
+
+void config_store_clear(config_store_t *cs) {
+    cs->len = 0;
+}
+
+bool config_store_commit(config_store_t *cs) {
+    static uint8_t page[FLASH_PAGE_SIZE] __aligned(4);
+    config_store_page_t *p = (config_store_page_t *)page;
+    memset(page, 0xFF, sizeof(page));
+    p->magic = CONFIG_STORE_MAGIC;
+    p->len = cs->len;
+    p->seq = cs->seq + 1;
+    memcpy(p + 1, cs->data, cs->len);
+    p->crc = page_crc(p);
+
+    // Próxima página livre depois da versão atual. Uma página suja (gravação
+    // interrompida) é pulada; o início de um setor é sempre apagado antes,
+    // e a versão atual está no outro setor.
+    uint16_t slot = cs->seq ? cs->slot + 1 : 0;
+    while (slot % PAGES_PER_SECTOR && !slot_blank(slot)) slot++;
+    slot %= CONFIG_STORE_SLOTS;
+    bool erase = slot % PAGES_PER_SECTOR == 0;
+
+    uint32_t offset = CONFIG_STORE_OFFSET + (uint32_t)slot * FLASH_PAGE_SIZE;
+    uint32_t irq = save_and_disable_interrupts();
+    if (erase) flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    flash_range_program(offset, page, FLASH_PAGE_SIZE);
+    restore_interrupts(irq);
+    if (erase) cs->erases++;
+
+    if (memcmp(slot_addr(slot), page, FLASH_PAGE_SIZE)) return false;
+    cs->seq = p->seq;
+    cs->slot = slot;
+    cs->commits++;
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hardware/flash.h"
+
+// Pares chave/valor persistentes nos últimos setores da flash de programa.
+// Cada gravação (commit) escreve uma versão completa de todas as entradas
+// numa página nova, com número de sequência e CRC-16; na leitura vale a
+// versão íntegra de maior sequência. As páginas são usadas em rodízio pelos
+// setores, e um setor só é apagado quando a gravação chega nele, com a
+// versão anterior a salvo no outro: uma queda de energia no meio perde no
+// máximo a versão nova.
+//
+// Leitura direto pelo XIP, sem tocar na flash. config_store_commit desliga
+// as IRQs por até ~50 ms (apagamento de setor) e exige que o outro núcleo
+// não esteja executando da flash: chamar antes de multicore_launch_core1.
+
+#define CONFIG_STORE_SECTORS   2
+#define CONFIG_STORE_SIZE      (CONFIG_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#define CONFIG_STORE_OFFSET    (PICO_FLASH_SIZE_BYTES - CONFIG_STORE_SIZE) // Fim da flash, longe do programa
+#define CONFIG_STORE_SLOTS     (CONFIG_STORE_SIZE / FLASH_PAGE_SIZE)
+#define CONFIG_STORE_MAGIC     0x4B56444Cu // "LDVK"
+#define CONFIG_STORE_DATA_MAX  (FLASH_PAGE_SIZE - sizeof(config_store_page_t))
+
+// Início de cada página; o CRC cobre de 'len' ao fim das entradas
+typedef struct {
+    uint32_t magic;
+    uint16_t crc;
+    uint16_t len;   // Bytes de entradas após o cabeçalho
+    uint32_t seq;   // Versão (1, 2, ...)
+} config_store_page_t;
+
+typedef struct {
+    // Cópia em RAM da versão atual: entradas { chave, tamanho, valor... }
+    uint8_t data[CONFIG_STORE_DATA_MAX];
+    uint16_t len;
+    uint32_t seq;       // Versão carregada ou gravada por último (0: nenhuma)
+    uint16_t slot;      // Página dessa versão
+    // Diagnóstico
+    uint16_t bad_pages; // Páginas com cabeçalho mas CRC inválido (gravação interrompida)
+    uint32_t commits, erases;
+} config_store_t;
+
+// Procura a versão mais recente; false se não houver nenhuma íntegra (a
+// cópia em RAM fica vazia)
+bool config_store_load(config_store_t *cs);
+// Copia o valor da chave; false se ausente ou de outro tamanho
+bool config_store_get(const config_store_t *cs, uint8_t key, void *value, size_t size);
+// Altera só a cópia em RAM; false se não couber numa página
+bool config_store_set(config_store_t *cs, uint8_t key, const void *value, size_t size);
+// Remove a entrada da cópia em RAM; false se ausente
+bool config_store_remove(config_store_t *cs, uint8_t key);
+// Remove todas as entradas da cópia em RAM
+void config_store_clear(config_store_t *cs);
+// Grava a cópia em RAM como nova versão e confere a página gravada
+bool config_store_commit(config_store_t *cs);
@@ -0,0 +1,80 @@
+#include "hardware/sync.h"
+#include "feedback.h"
+
+void feedback_init(feedback_channel_t *ch, feedback_output_t output, uint32_t value) {
+    ch->output = output;
+    ch->steps = NULL;
+    ch->index = 0;
+    ch->q_head = ch->q_tail = 0;
+    ch->alarm = 0;
+    ch->value = value;
+    output(value);
+}
+
+// Aplica passos até um com duração e retorna essa duração em us; 0 quando
+// a fila acabou. Chamada com as IRQs desligadas ou no callback do alarme.
+static int64_t feedback_advance(feedback_channel_t *ch) {
+    while (true) {
+        if (!ch->steps) {
+            if (ch->q_head == ch->q_tail) return 0;
+            ch->steps = ch->queue[ch->q_tail++ % FEEDBACK_QUEUE_LEN];
+            ch->index = 0;
+        }
+        const feedback_step_t *step = &ch->steps[ch->index++];
+        if (step->ms == FEEDBACK_REPEAT) {
+            // Fim da volta: cede a vez a um padrão na fila ou recomeça
+            if (ch->q_head != ch->q_tail || ch->index == 1) {
+                ch->steps = NULL;
+                continue;
+            }
+            ch->index = 0;
+            step = &ch->steps[ch->index++];
+        }
+        ch->value = step->value;
+        ch->output(step->value);
+        if (step->ms) return (int64_t)step->ms * 1000;
+        ch->steps = NULL;
+    }
+}
+
+// Retorno negativo: o próximo passo conta a partir do instante programado,
+// sem acumular o atraso da IRQ
+static int64_t feedback_alarm(alarm_id_t id, void *user_data) {
+    feedback_channel_t *ch = (feedback_channel_t *)user_data;
+    int64_t us = feedback_advance(ch);
+    if (!us) ch->alarm = 0;
+    return -us;
+}
+
+bool feedback_play(feedback_channel_t *ch, const feedback_step_t *steps) {
+    uint32_t irq = save_and_disable_interrupts();
+    bool ok = ch->q_head - ch->q_tail < FEEDBACK_QUEUE_LEN;
+    if (ok) {
+        ch->queue[ch->q_head++ % FEEDBACK_QUEUE_LEN] = steps;
+        if (!ch->alarm) {
+            int64_t us = feedback_advance(ch);
+            // Sem alarme livre o padrão para no passo atual
+            if (us) ch->alarm = add_alarm_in_us(us, feedback_alarm, ch, true);
+            if (ch->alarm < 0) ch->alarm = 0;
+        }
+    }
+    restore_interrupts(irq);
+    return ok;
+}
+
+void feedback_set(feedback_channel_t *ch, uint32_t value) {
+    uint32_t irq = save_and_disable_interrupts();
+    if (ch->alarm) cancel_alarm(ch->alarm);
+    ch->alarm = 0;
+    ch->steps = NULL;
+    ch->q_tail = ch->q_head;
+    if (value != ch->value) {
+        ch->value = value;
+        ch->output(value);
+    }
+    restore_interrupts(irq);
+}
+
+bool feedback_busy(const feedback_channel_t *ch) {
+    return ch->alarm || ch->steps || ch->q_head != ch->q_tail;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+// Sequenciador de padrões para saídas de sinalização (buzzer, LED RGB).
+// Cada canal toca, em segundo plano, padrões de uma fila: cada passo
+// aplica um valor à saída e dura alguns milissegundos, contados por um
+// alarme do pool padrão. Nada espera no laço principal; os callbacks só
+// escrevem registradores de GPIO/PWM, então não atrasam a aquisição nem a
+// gravação.
+//
+// As funções públicas devem ser chamadas pelo núcleo dono do pool de
+// alarmes (o 0): a exclusão com o callback é feita desligando IRQs.
+
+#define FEEDBACK_QUEUE_LEN 4
+#define FEEDBACK_REPEAT    0xFFFF // Em 'ms': volta ao primeiro passo (até chegar outro padrão)
+
+typedef struct {
+    uint32_t value;  // Valor da saída durante o passo
+    uint16_t ms;     // Duração; 0 encerra o padrão mantendo 'value'
+} feedback_step_t;
+
+// Aplica um valor à saída; chamada também no contexto da IRQ do alarme
+typedef void (*feedback_output_t)(uint32_t value);
+
+typedef struct {
+    feedback_output_t output;
+    const feedback_step_t *volatile steps; // Padrão em curso (NULL: nenhum)
+    uint8_t index;
+    const feedback_step_t *queue[FEEDBACK_QUEUE_LEN];
+    volatile uint32_t q_head, q_tail;
+    volatile alarm_id_t alarm;     // 0: nenhum passo em andamento
+    uint32_t value;                // Último valor aplicado
+} feedback_channel_t;
+
+void feedback_init(feedback_channel_t *ch, feedback_output_t output, uint32_t value);
+// Enfileira um padrão; começa na hora se o canal estiver parado. Um padrão
+// com FEEDBACK_REPEAT termina na próxima volta depois que outro chega.
+// Retorna false com a fila cheia.
+bool feedback_play(feedback_channel_t *ch, const feedback_step_t *steps);
+// Descarta o padrão em curso e a fila e fixa o valor
+void feedback_set(feedback_channel_t *ch, uint32_t value);
+// Há padrão tocando ou na fila
+bool feedback_busy(const feedback_channel_t *ch);
@@ -0,0 +1,179 @@
+#include "i2c_dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+// Uma instância por controlador, para o tratador da IRQ do I2C
+static i2c_dma_t *i2c_dma_buses[2];
+
+#define I2C_DMA_IRQ_MASK (I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS)
+
+// Dispara a transação: o canal RX fica armado à espera do DREQ e o TX
+// alimenta IC_DATA_CMD com as palavras de comando.
+static void i2c_dma_start(i2c_dma_t *bus, i2c_dma_xfer_t *xfer) {
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+
+    // O endereço do escravo só pode ser trocado com o controlador desligado
+    hw->enable = 0;
+    hw->tar = xfer->addr;
+    hw->enable = 1;
+    (void)hw->clr_intr;
+
+    bus->active = xfer;
+    xfer->status = I2C_DMA_BUSY;
+    if (xfer->rx_count)
+        dma_channel_configure(bus->rx_dma, &bus->rx_cfg, xfer->rx, &hw->data_cmd,
+                              xfer->rx_count, true);
+    dma_channel_configure(bus->tx_dma, &bus->tx_cfg, &hw->data_cmd, xfer->cmds,
+                          xfer->cmd_count, true);
+    hw->intr_mask = I2C_DMA_IRQ_MASK;
+}
+
+static void i2c_dma_start_next(i2c_dma_t *bus) {
+    if (bus->q_tail == bus->q_head) {
+        bus->active = NULL;
+        return;
+    }
+    i2c_dma_xfer_t *next = bus->queue[bus->q_tail % I2C_DMA_QUEUE_LEN];
+    bus->q_tail++;
+    i2c_dma_start(bus, next);
+}
+
+static void i2c_dma_irq(i2c_dma_t *bus) {
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    i2c_dma_xfer_t *xfer = bus->active;
+    uint32_t stat = hw->intr_stat;
+    if (!xfer) {
+        hw->intr_mask = 0;
+        (void)hw->clr_intr;
+        return;
+    }
+
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // NACK ou perda de arbitragem: a FIFO TX foi descartada pelo
+        // controlador e só volta a aceitar dados após ler clr_tx_abrt
+        dma_channel_abort(bus->tx_dma);
+        dma_channel_abort(bus->rx_dma);
+        (void)hw->clr_tx_abrt;
+        // Espera o STOP gerado pelo abort, para que ele não encerre a
+        // próxima transação da fila
+        while (hw->status & I2C_IC_STATUS_ACTIVITY_BITS) tight_loop_contents();
+        xfer->status = I2C_DMA_ABORTED;
+        bus->aborted++;
+    } else if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        // O último byte já está na FIFO RX; o DMA o copia em poucos ciclos
+        if (xfer->rx_count) dma_channel_wait_for_finish_blocking(bus->rx_dma);
+        xfer->status = I2C_DMA_DONE;
+        bus->completed++;
+        bus->bytes += xfer->cmd_count;
+    } else {
+        return;
+    }
+
+    hw->intr_mask = 0;
+    (void)hw->clr_intr;
+    bus->i2c->restart_on_next = false;
+    i2c_dma_start_next(bus);
+    if (xfer->callback) xfer->callback(xfer);
+}
+
+static void i2c_dma_irq0(void) { i2c_dma_irq(i2c_dma_buses[0]); }
+static void i2c_dma_irq1(void) { i2c_dma_irq(i2c_dma_buses[1]); }
+
+// O controlador já deve ter sido configurado com i2c_init
+bool i2c_dma_init(i2c_dma_t *bus, i2c_inst_t *i2c) {
+    uint index = i2c_hw_index(i2c);
+    int tx = dma_claim_unused_channel(false);
+    int rx = dma_claim_unused_channel(false);
+    if (tx < 0 || rx < 0) {
+        if (tx >= 0) dma_channel_unclaim(tx);
+        if (rx >= 0) dma_channel_unclaim(rx);
+        return false;
+    }
+
+    bus->i2c = i2c;
+    bus->tx_dma = (uint)tx;
+    bus->rx_dma = (uint)rx;
+    bus->q_head = bus->q_tail = 0;
+    bus->active = NULL;
+    bus->completed = bus->aborted = bus->bytes = 0;
+
+    // TX: palavras de 16 bits (byte + CMD/STOP/RESTART) para IC_DATA_CMD
+    bus->tx_cfg = dma_channel_get_default_config(bus->tx_dma);
+    channel_config_set_transfer_data_size(&bus->tx_cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&bus->tx_cfg, true);
+    channel_config_set_write_increment(&bus->tx_cfg, false);
+    channel_config_set_dreq(&bus->tx_cfg, i2c_get_dreq(i2c, true));
+
+    // RX: bytes lidos de IC_DATA_CMD para o buffer de destino
+    bus->rx_cfg = dma_channel_get_default_config(bus->rx_dma);
+    channel_config_set_transfer_data_size(&bus->rx_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&bus->rx_cfg, false);
+    channel_config_set_write_increment(&bus->rx_cfg, true);
+    channel_config_set_dreq(&bus->rx_cfg, i2c_get_dreq(i2c, false));
+
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    // O valor de reset de IC_INTR_MASK habilita várias fontes
+    hw->intr_mask = 0;
+    (void)hw->clr_intr;
+
+    i2c_dma_buses[index] = bus;
+    irq_set_exclusive_handler(I2C0_IRQ + index, index ? i2c_dma_irq1 : i2c_dma_irq0);
+    irq_set_enabled(I2C0_IRQ + index, true);
+    return true;
+}
+
+// Enfileira a transação. Os buffers de comando e de leitura devem continuar
+// válidos até o fim. Retorna false se a fila estiver cheia.
+bool i2c_dma_submit(i2c_dma_t *bus, i2c_dma_xfer_t *xfer) {
+    if (!xfer->cmd_count) return false;
+    uint32_t irq_state = save_and_disable_interrupts();
+    bool ok = true;
+    if (!bus->active) {
+        i2c_dma_start(bus, xfer);
+    } else if (bus->q_head - bus->q_tail < I2C_DMA_QUEUE_LEN) {
+        xfer->status = I2C_DMA_QUEUED;
+        bus->queue[bus->q_head % I2C_DMA_QUEUE_LEN] = xfer;
+        bus->q_head++;
+    } else {
+        ok = false;
+    }
+    restore_interrupts(irq_state);
+    return ok;
+}
+
+bool i2c_dma_idle(const i2c_dma_t *bus) {
+    return bus->active == NULL;
+}
+
+void i2c_dma_wait_idle(const i2c_dma_t *bus) {
+    while (bus->active) tight_loop_contents();
+}
+
+// Aguarda a transação terminar; retorna false se ela foi abortada
+bool i2c_dma_wait(const i2c_dma_xfer_t *xfer) {
+    while (xfer->status == I2C_DMA_QUEUED || xfer->status == I2C_DMA_BUSY)
+        tight_loop_contents();
+    return xfer->status == I2C_DMA_DONE;
+}
+
+uint32_t i2c_dma_build_write(uint16_t *cmds, const uint8_t *data, uint32_t len, bool stop) {
+    for (uint32_t i = 0; i < len; i++) cmds[i] = data[i];
+    if (len && stop) cmds[len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    return len;
+}
+
+// Cada byte lido exige uma palavra com o bit CMD; a última encerra com STOP
+uint32_t i2c_dma_build_read(uint16_t *cmds, uint32_t len, bool restart) {
+    for (uint32_t i = 0; i < len; i++) cmds[i] = I2C_IC_DATA_CMD_CMD_BITS;
+    if (!len) return 0;
+    if (restart) cmds[0] |= I2C_IC_DATA_CMD_RESTART_BITS;
+    cmds[len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    return len;
+}
+
+// Escreve o endereço do registrador e lê len bytes após um RESTART
+uint32_t i2c_dma_build_read_reg(uint16_t *cmds, uint8_t reg, uint32_t len) {
+    cmds[0] = reg;
+    return 1 + i2c_dma_build_read(&cmds[1], len, true);
+}
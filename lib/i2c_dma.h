@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+
+// Transações I2C assíncronas via DMA. Cada controlador usa dois canais de
+// DMA (TX e RX) obtidos com dma_claim_unused_channel, como o driver SPI do
+// cartão SD, e sinaliza o fim pela IRQ do próprio I2C (STOP_DET/TX_ABRT),
+// sem tocar nas linhas DMA_IRQ_0/1 usadas pelo SPI.
+//
+// Enquanto houver transação ativa, as funções bloqueantes do SDK não podem
+// ser usadas no mesmo controlador: aguarde com i2c_dma_wait_idle().
+
+#define I2C_DMA_QUEUE_LEN 8
+
+typedef enum {
+    I2C_DMA_IDLE = 0,
+    I2C_DMA_QUEUED,
+    I2C_DMA_BUSY,
+    I2C_DMA_DONE,
+    I2C_DMA_ABORTED
+} i2c_dma_status_t;
+
+typedef struct i2c_dma_xfer i2c_dma_xfer_t;
+// Chamada no contexto da IRQ do I2C quando a transação termina
+typedef void (*i2c_dma_callback_t)(i2c_dma_xfer_t *xfer);
+
+struct i2c_dma_xfer {
+    uint8_t addr;
+    const uint16_t *cmds;  // Palavras para IC_DATA_CMD (byte + bits CMD/STOP/RESTART)
+    uint32_t cmd_count;
+    uint8_t *rx;           // Destino dos bytes lidos (NULL em escritas)
+    uint32_t rx_count;
+    i2c_dma_callback_t callback;
+    void *user_data;
+    volatile i2c_dma_status_t status;
+};
+
+typedef struct {
+    i2c_inst_t *i2c;
+    uint tx_dma;
+    uint rx_dma;
+    dma_channel_config tx_cfg;
+    dma_channel_config rx_cfg;
+    i2c_dma_xfer_t *queue[I2C_DMA_QUEUE_LEN];
+    volatile uint32_t q_head, q_tail;
+    i2c_dma_xfer_t *volatile active;
+    volatile uint32_t completed;
+    volatile uint32_t aborted;
+    volatile uint32_t bytes;  // Palavras enviadas ao barramento
+} i2c_dma_t;
+
+bool i2c_dma_init(i2c_dma_t *bus, i2c_inst_t *i2c);
+bool i2c_dma_submit(i2c_dma_t *bus, i2c_dma_xfer_t *xfer);
+bool i2c_dma_idle(const i2c_dma_t *bus);
+void i2c_dma_wait_idle(const i2c_dma_t *bus);
+bool i2c_dma_wait(const i2c_dma_xfer_t *xfer);
+
+// Montagem das palavras de comando. Retornam quantas palavras foram escritas.
+uint32_t i2c_dma_build_write(uint16_t *cmds, const uint8_t *data, uint32_t len, bool stop);
+uint32_t i2c_dma_build_read(uint16_t *cmds, uint32_t len, bool restart);
+uint32_t i2c_dma_build_read_reg(uint16_t *cmds, uint8_t reg, uint32_t len);
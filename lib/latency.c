@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <string.h>
+#include "latency.h"
+
+#if LATENCY_STATS
+
+latency_hist_t latency_hists[LAT_STAGE_COUNT];
+
+static const char *const latency_names[LAT_STAGE_COUNT] = {
+    [LAT_I2C_READ] = "leitura I2C",
+    [LAT_OFFSET] = "offsets",
+    [LAT_FORMAT] = "formatacao",
+    [LAT_WRITE] = "f_write",
+    [LAT_SYNC] = "f_sync",
+    [LAT_DISPLAY] = "display",
+    [LAT_SD_CMD] = "SD comando",
+    [LAT_SD_DATA] = "SD dados",
+    [LAT_SD_BUSY] = "SD ocupado",
+};
+
+void latency_record(latency_stage_t stage, uint32_t us) {
+    latency_hist_t *h = &latency_hists[stage];
+    uint32_t b = us ? 32 - __builtin_clz(us) : 0;
+    if (b >= LATENCY_BUCKETS) b = LATENCY_BUCKETS - 1;
+    h->buckets[b]++;
+    if (!h->count || us < h->min_us) h->min_us = us;
+    if (us > h->max_us) h->max_us = us;
+    h->count++;
+}
+
+void latency_reset(void) {
+    memset(latency_hists, 0, sizeof(latency_hists));
+}
+
+uint32_t latency_percentile(latency_stage_t stage, uint32_t p) {
+    const latency_hist_t *h = &latency_hists[stage];
+    if (!h->count) return 0;
+    uint32_t target = (uint32_t)(((uint64_t)h->count * p + 99) / 100);
+    uint32_t seen = 0;
+    uint32_t b = 0;
+    for (; b < LATENCY_BUCKETS - 1; b++) {
+        seen += h->buckets[b];
+        if (seen >= target) break;
+    }
+    uint32_t upper = b ? (1u << b) - 1 : 0;
+    if (upper < h->min_us) upper = h->min_us;
+    if (upper > h->max_us || b == LATENCY_BUCKETS - 1) upper = h->max_us;
+    return upper;
+}
+
+FRESULT latency_report(const char *path) {
+    FIL fil;
+    FRESULT fr = FR_OK;
+    bool to_file = false;
+    if (path) {
+        fr = f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE);
+        to_file = fr == FR_OK;
+    }
+    char line[80];
+    for (int i = -1; i < LAT_STAGE_COUNT; i++) {
+        int len;
+        if (i < 0) {
+            len = snprintf(line, sizeof(line), "Latencia (us)        n      min    p50    p99    max\n");
+        } else {
+            const latency_hist_t *h = &latency_hists[i];
+            if (!h->count) continue;
+            len = snprintf(line, sizeof(line), "  %-12s %8lu %6lu %6lu %6lu %8lu\n", latency_names[i],
+                           h->count, h->min_us, latency_percentile(i, 50),
+                           latency_percentile(i, 99), h->max_us);
+        }
+        printf("%s", line);
+        if (to_file && fr == FR_OK) {
+            UINT bw;
+            fr = f_write(&fil, line, (UINT)len, &bw);
+        }
+    }
+    if (to_file) {
+        FRESULT cr = f_close(&fil);
+        if (fr == FR_OK) fr = cr;
+    }
+    return fr;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "ff.h"
+
+// Histogramas de latência por estágio do caminho de gravação. Cada medida
+// é a diferença de dois time_us_32 e cai em um balde log2 (balde b conta
+// de 2^(b-1) a 2^b - 1 us); min e max são exatos, p50 e p99 são o limite
+// superior do balde onde caem (precisão de 2x).
+//
+// Com LATENCY_STATS 0 (aqui ou -DLATENCY_STATS=0 no CMake) as macros não
+// geram código nenhum e o módulo fica vazio.
+//
+// Não há travas: cada estágio deve ser registrado por um núcleo de cada vez
+// (IRQs do núcleo 0 para o sensor, núcleo 1 para o cartão durante a
+// gravação, núcleo 0 para o display e fora da gravação).
+
+#ifndef LATENCY_STATS
+#define LATENCY_STATS 1
+#endif
+
+typedef enum {
+    LAT_I2C_READ,   // Leitura do sensor: amostra avulsa ou rajada da FIFO
+    LAT_OFFSET,     // Subtração dos offsets de calibração
+    LAT_FORMAT,     // Registro binário ou linha CSV de uma amostra
+    LAT_WRITE,      // f_write de um lote (ou envio ao CMD25 no modo contíguo)
+    LAT_SYNC,       // f_sync / checkpoint
+    LAT_DISPLAY,    // update_display completo
+    LAT_SD_CMD,     // Driver do SD: pacote de comando até a resposta R1
+    LAT_SD_DATA,    // Driver do SD: um bloco de dados com CRC e resposta
+    LAT_SD_BUSY,    // Driver do SD: cartão ocupado programando
+    LAT_STAGE_COUNT
+} latency_stage_t;
+
+#define LATENCY_BUCKETS 24  // Último balde: 4,2 s ou mais
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+#if LATENCY_STATS
+
+extern latency_hist_t latency_hists[LAT_STAGE_COUNT];
+
+void latency_record(latency_stage_t stage, uint32_t us);
+
+void latency_reset(void);
+// Percentil p (1-100) de um estágio, limitado a [min, max]
+uint32_t latency_percentile(latency_stage_t stage, uint32_t p);
+// Tabela n/min/p50/p99/max no USB; se 'path' não for NULL, também no
+// arquivo (volume montado e sem gravação em curso)
+FRESULT latency_report(const char *path);
+
+// Início e fim de uma medida no mesmo escopo
+#define LATENCY_BEGIN(var) uint32_t var = time_us_32()
+#define LATENCY_END(stage, var) latency_record(stage, time_us_32() - (var))
+
+#else
+
+#define LATENCY_BEGIN(var) do {} while (0)
+#define LATENCY_END(stage, var) do {} while (0)
+
+#endif
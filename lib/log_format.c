@@ -0,0 +1,99 @@
+#include <string.h>
+#include "log_format.h"
+
+void log_header_init(log_file_header_t *h, uint16_t odr_hz, uint8_t flags,
+                     const long accel_offset[3], const long gyro_offset[3],
+                     uint32_t start_fattime, uint32_t start_epoch, uint64_t start_us) {
+    memset(h, 0, sizeof(*h));
+    h->magic = LOG_MAGIC;
+    h->version = LOG_VERSION;
+    h->header_size = sizeof(log_file_header_t);
+    h->block_samples = LOG_BLOCK_SAMPLES;
+    h->odr_hz = odr_hz;
+    // O driver mantém as faixas padrão do sensor
+    h->accel_fs_sel = 0;
+    h->gyro_fs_sel = 0;
+    h->flags = flags;
+    for (int i = 0; i < 3; i++) {
+        h->accel_offset[i] = (int16_t)accel_offset[i];
+        h->gyro_offset[i] = (int16_t)gyro_offset[i];
+    }
+    h->start_fattime = start_fattime;
+    h->start_us = start_us;
+    h->start_epoch = start_epoch;
+    h->block_count = LOG_COUNT_UNKNOWN;
+}
+
+void log_encoder_reset(log_encoder_t *e) {
+    memset(e, 0, sizeof(*e));
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+// Grava count e size no cabeçalho do bloco aberto e o entrega
+static size_t close_block(log_encoder_t *e, const uint8_t **block) {
+    log_block_t *b = (log_block_t *)e->buf[e->cur];
+    size_t len = e->len;
+    b->size = e->len;
+    e->samples += b->count;
+    e->blocks++;
+    e->bytes += len;
+    *block = e->buf[e->cur];
+    e->cur ^= 1;
+    e->len = 0;
+    return len;
+}
+
+size_t log_encode(log_encoder_t *e, const imu_sample_t *sample, const uint8_t **block) {
+    size_t done = 0;
+    uint64_t dt = sample->timestamp_us - e->last_us;
+    if (e->len && (sample->seq != e->next_seq || sample->timestamp_us < e->last_us ||
+                   dt > LOG_MAX_DT_US))
+        done = close_block(e, block);
+
+    if (!e->len) {
+        // Quadro-chave: a amostra inteira no cabeçalho do bloco
+        log_block_t *b = (log_block_t *)e->buf[e->cur];
+        b->marker = LOG_BLOCK_MARKER;
+        b->count = 1;
+        b->seq = sample->seq;
+        b->timestamp_us = sample->timestamp_us;
+        memcpy(b->accel, sample->accel, sizeof(b->accel));
+        memcpy(b->gyro, sample->gyro, sizeof(b->gyro));
+        e->len = sizeof(log_block_t);
+        e->last_dt = 0;
+    } else {
+        log_block_t *b = (log_block_t *)e->buf[e->cur];
+        uint8_t *p = e->buf[e->cur] + e->len;
+        p = put_varint(p, zigzag((int32_t)((uint32_t)dt - e->last_dt)));
+        for (int i = 0; i < 3; i++) p = put_varint(p, zigzag(sample->accel[i] - e->last[i]));
+        for (int i = 0; i < 3; i++) p = put_varint(p, zigzag(sample->gyro[i] - e->last[3 + i]));
+        e->len = (uint16_t)(p - e->buf[e->cur]);
+        e->last_dt = (uint32_t)dt;
+        b->count++;
+    }
+    e->next_seq = sample->seq + 1;
+    e->last_us = sample->timestamp_us;
+    memcpy(e->last, sample->accel, sizeof(sample->accel));
+    memcpy(&e->last[3], sample->gyro, sizeof(sample->gyro));
+
+    // Um bloco recém-aberto tem uma amostra: nunca fecha duas vezes na mesma chamada
+    if (((log_block_t *)e->buf[e->cur])->count == LOG_BLOCK_SAMPLES)
+        done = close_block(e, block);
+    return done;
+}
+
+size_t log_encoder_flush(log_encoder_t *e, const uint8_t **block) {
+    return e->len ? close_block(e, block) : 0;
+}
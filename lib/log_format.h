@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sampler.h"
+
+// Formato binário do log (datalog_NNNN/seg_NNNN.bin). Cada segmento de uma
+// sessão começa com um log_file_header_t seguido de block_count blocos de
+// tamanho variável. Arquivos de versões anteriores podem ter várias sessões
+// anexadas, cada uma com seu cabeçalho. Todos os campos são little-endian,
+// como no RP2040. O leitor de referência está em analise_dados.py.
+//
+// Um bloco guarda até LOG_BLOCK_SAMPLES amostras consecutivas e se decodifica
+// sozinho: o cabeçalho (log_block_t) traz a primeira amostra inteira, com seq
+// e timestamp absolutos (o quadro-chave); cada amostra seguinte é uma
+// sequência de varints (7 bits por byte, bit 7 = continua) em zigzag
+// (0, -1, 1, -2... -> 0, 1, 2, 3...):
+//   - variação do intervalo de tempo em us em relação ao intervalo anterior
+//     (a segunda amostra do bloco usa 0 como anterior);
+//   - accel[0..2] e gyro[0..2] menos os da amostra anterior.
+// O seq cresce de 1 em 1 dentro do bloco: amostra perdida, tempo voltando
+// ou intervalo acima de LOG_MAX_DT_US fecham o bloco e abrem outro.
+
+#define LOG_MAGIC            0x4C554D49u  // "IMUL" no arquivo
+#define LOG_VERSION          3
+// block_count de uma sessão interrompida (sem f_close): ler até o fim
+#define LOG_COUNT_UNKNOWN    0xFFFFFFFFu
+
+// Bits de log_file_header_t.flags
+#define LOG_FLAG_FIFO        (1 << 0)  // Amostras vindas da FIFO do sensor
+#define LOG_FLAG_INT_TRIGGER (1 << 1)  // Aquisição disparada pelo pino INT
+
+#define LOG_BLOCK_MARKER     0x4B42       // "BK" no arquivo
+#define LOG_BLOCK_SAMPLES    64
+#define LOG_MAX_DT_US        1000000u
+// Pior caso de uma amostra delta: tempo (5 bytes) e 6 eixos (3 bytes cada)
+#define LOG_DELTA_MAX_BYTES  (5 + 6 * 3)
+#define LOG_BLOCK_MAX        (sizeof(log_block_t) + (LOG_BLOCK_SAMPLES - 1) * LOG_DELTA_MAX_BYTES)
+// Amostra sem compressão (seq, timestamp e eixos, como no formato 1): base
+// da taxa de compressão
+#define LOG_RAW_SAMPLE_SIZE  24
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;      // sizeof(log_file_header_t)
+    uint16_t block_samples;    // LOG_BLOCK_SAMPLES
+    uint16_t odr_hz;           // Taxa de amostragem configurada
+    uint8_t accel_fs_sel;      // AFS_SEL do MPU6050 (0 = ±2 g)
+    uint8_t gyro_fs_sel;       // FS_SEL do MPU6050 (0 = ±250 °/s)
+    uint8_t flags;
+    uint8_t reserved;
+    int16_t accel_offset[3];   // Offsets de calibração já subtraídos
+    int16_t gyro_offset[3];
+    uint32_t start_fattime;    // Data/hora do início no formato FAT (get_fattime)
+    uint64_t start_us;         // time_us_64 no início da sessão
+    uint32_t start_epoch;      // Hora Unix do RTC em start_us (0: RTC sem data)
+    uint32_t block_count;      // Atualizado ao fechar o arquivo
+} log_file_header_t;
+
+// Início de cada bloco, seguido das amostras delta
+typedef struct __attribute__((packed)) {
+    uint16_t marker;           // LOG_BLOCK_MARKER
+    uint16_t size;             // Bytes do bloco, este cabeçalho incluído
+    uint16_t count;            // Amostras no bloco (>= 1)
+    uint32_t seq;              // Da primeira amostra
+    uint64_t timestamp_us;     // Da primeira amostra, mesmo relógio de start_us
+    int16_t accel[3];
+    int16_t gyro[3];
+} log_block_t;
+
+_Static_assert(sizeof(log_file_header_t) == 48, "cabeçalho do log mudou de tamanho");
+_Static_assert(sizeof(log_block_t) == 30, "cabeçalho de bloco mudou de tamanho");
+
+#define LOG_HEADER_COUNT_OFFSET offsetof(log_file_header_t, block_count)
+
+// Codificador de uma sessão. Dois buffers: um bloco fechado continua
+// válido enquanto a amostra que o fechou abre o próximo no outro.
+typedef struct {
+    uint8_t buf[2][LOG_BLOCK_MAX];
+    uint8_t cur;             // Buffer do bloco aberto
+    uint16_t len;            // Bytes do bloco aberto (0: nenhum)
+    uint32_t next_seq;
+    uint64_t last_us;
+    uint32_t last_dt;
+    int16_t last[6];         // accel e gyro da amostra anterior
+    // Totais da sessão (blocos fechados)
+    uint32_t samples, blocks, bytes;
+} log_encoder_t;
+
+void log_header_init(log_file_header_t *h, uint16_t odr_hz, uint8_t flags,
+                     const long accel_offset[3], const long gyro_offset[3],
+                     uint32_t start_fattime, uint32_t start_epoch, uint64_t start_us);
+void log_encoder_reset(log_encoder_t *e);
+// Acrescenta uma amostra ao bloco aberto. Quando um bloco fica pronto
+// (completou LOG_BLOCK_SAMPLES, ou a amostra não continua a sequência e
+// abre outro), retorna o tamanho e o aponta em *block; senão 0. O bloco
+// vale até a próxima chamada.
+size_t log_encode(log_encoder_t *e, const imu_sample_t *sample, const uint8_t **block);
+// Fecha o bloco aberto no fim da sessão; 0 se não havia
+size_t log_encoder_flush(log_encoder_t *e, const uint8_t **block);
@@ -0,0 +1,263 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "log_writer.h"
+#include "latency.h"
+#include "hw_config.h"
+
+// Espelho do flag interno do ff.c: faz o f_sync regravar a entrada de diretório
+#define LOG_FA_MODIFIED 0x40
+
+static void log_writer_consume(log_writer_t *w, uint32_t len) {
+    w->bytes += len;
+    w->unsynced += len;
+    w->fill -= len;
+    if (w->fill) memmove(w->buf, w->buf + len, w->fill);
+}
+
+static void log_writer_fail(log_writer_t *w, FRESULT fr) {
+    w->errors++;
+    w->last_error = fr;
+    // Descarta o lote para não travar a gravação em um cartão cheio
+    w->fill = 0;
+}
+
+// Recolhe o resultado da escrita assíncrona anterior, se houver. As IRQs do
+// cartão não esperam por ele: um lote que falhou lá é regravado aqui, no
+// núcleo do gravador, pelo caminho síncrono.
+static bool log_writer_wait(log_writer_t *w) {
+    if (!w->op_pending) return true;
+    w->op_pending = false;
+    if (sd_async_wait(&w->op) == SD_BLOCK_DEVICE_ERROR_NONE) return true;
+    w->retries++;
+    if (sd_async_retry(&w->op) != SD_BLOCK_DEVICE_ERROR_NONE) {
+        w->errors++;
+        w->last_error = FR_DISK_ERR;
+        return false;
+    }
+    return true;
+}
+
+// Modo contíguo: len é múltiplo de setor e continua a sessão CMD25 aberta.
+// O lote sai por DMA enquanto o resto do buffer passa para o outro lado do
+// buffer duplo; o gravador só espera se o cartão ainda estiver ocupado com
+// o lote anterior quando este encher.
+static bool log_writer_write_direct(log_writer_t *w, uint32_t len) {
+    if (w->pos + len > w->capacity) {
+        log_writer_fail(w, FR_DENIED);  // Extensão pré-alocada esgotada
+        return false;
+    }
+    log_writer_wait(w);
+    w->writes++;
+    w->op.buffer = w->buf;
+    w->op.ulSectorNumber = w->base_lba + (LBA_t)(w->pos / LOG_WRITER_SECTOR);
+    w->op.blockCnt = len / LOG_WRITER_SECTOR;
+    w->op.callback = NULL;
+    if (sd_write_blocks_async(w->card, &w->op) != SD_BLOCK_DEVICE_ERROR_NONE) {
+        log_writer_fail(w, FR_DISK_ERR);
+        return false;
+    }
+    w->op_pending = true;
+    w->pos += len;
+    w->bytes += len;
+    w->unsynced += len;
+    w->fill -= len;
+    uint8_t *next = w->buf == w->bufs[0] ? w->bufs[1] : w->bufs[0];
+    if (w->fill) memcpy(next, w->buf + len, w->fill);
+    w->buf = next;
+    return true;
+}
+
+static bool log_writer_write(log_writer_t *w, uint32_t len) {
+    LATENCY_BEGIN(start);
+    if (w->direct) {
+        bool ok = log_writer_write_direct(w, len);
+        LATENCY_END(LAT_WRITE, start);
+        return ok;
+    }
+    UINT bw;
+    FRESULT fr = f_write(w->fil, w->buf, len, &bw);
+    LATENCY_END(LAT_WRITE, start);
+    w->writes++;
+    if (fr != FR_OK || bw != len) {
+        log_writer_fail(w, fr != FR_OK ? fr : FR_DISK_ERR);
+        return false;
+    }
+    log_writer_consume(w, len);
+    return true;
+}
+
+// Entrega ao FatFs tudo o que termina em uma fronteira de setor do arquivo;
+// o resto fica no buffer. Só o primeiro lote após um f_sync parcial sai
+// desalinhado, para reencontrar a fronteira.
+static bool log_writer_flush_aligned(log_writer_t *w) {
+    uint32_t end = (uint32_t)((w->direct ? w->pos : f_tell(w->fil)) + w->fill);
+    uint32_t len = w->fill - end % LOG_WRITER_SECTOR;
+    if (len == 0) return true;
+    return log_writer_write(w, len);
+}
+
+// Grava no diretório o tamanho útil do arquivo contíguo. Em memória o
+// objeto continua com o tamanho pré-alocado, para o f_truncate final.
+static FRESULT log_writer_commit_size(log_writer_t *w, FSIZE_t size) {
+    w->fil->obj.objsize = size;
+    w->fil->flag |= LOG_FA_MODIFIED;
+    FRESULT fr = f_sync(w->fil);
+    w->fil->obj.objsize = w->capacity;
+    return fr;
+}
+
+void log_writer_begin(log_writer_t *w, const log_sync_policy_t *policy) {
+    w->fil = NULL;
+    w->policy = *policy;
+    w->bytes = w->writes = w->syncs = w->errors = w->retries = 0;
+    w->stream_blocks = w->stream_reopens = 0;
+    w->last_error = FR_OK;
+    w->direct = false;
+    w->card = NULL;
+    w->start_us = time_us_64();
+    w->end_us = 0;
+}
+
+// Pré-aloca 'capacity' bytes contíguos no arquivo e passa a gravar os
+// setores diretamente no cartão, sem tocar na FAT nem no diretório fora
+// dos checkpoints. Se não houver espaço contíguo, retorna o erro do
+// f_expand e o gravador segue no modo f_write.
+static FRESULT log_writer_expand(log_writer_t *w, FSIZE_t capacity) {
+    FRESULT fr = f_expand(w->fil, capacity, 1);
+    if (fr != FR_OK) return fr;
+
+    FATFS *fs = w->fil->obj.fs;
+    w->card = sd_get_by_num(fs->pdrv);
+    if (!w->card) return FR_INVALID_DRIVE;
+    w->direct = true;
+    w->base_lba = fs->database + (LBA_t)fs->csize * (w->fil->obj.sclust - 2);
+    w->capacity = capacity;
+    // Registra a cadeia no cartão; o tamanho útil ainda é zero
+    fr = log_writer_commit_size(w, 0);
+    // Abre o CMD25 já com a extensão inteira como dica de pré-apagamento.
+    // Se falhar, o primeiro sd_stream_write tenta de novo.
+    if (fr == FR_OK) sd_stream_begin(w->card, w->base_lba, (uint32_t)(capacity / LOG_WRITER_SECTOR));
+    return fr;
+}
+
+FRESULT log_writer_open(log_writer_t *w, FIL *fil, FSIZE_t capacity) {
+    w->fil = fil;
+    w->buf = w->bufs[0];
+    w->fill = 0;
+    w->unsynced = 0;
+    w->direct = false;
+    w->op_pending = false;
+    w->pos = w->capacity = 0;
+    w->last_sync_us = time_us_64();
+    w->end_us = 0;
+    return capacity ? log_writer_expand(w, capacity) : FR_OK;
+}
+
+FSIZE_t log_writer_size(const log_writer_t *w) {
+    return (w->direct ? w->pos : f_tell(w->fil)) + w->fill;
+}
+
+// Copia dados para o buffer, esvaziando-o quando enche
+bool log_writer_append(log_writer_t *w, const void *data, uint32_t len) {
+    const uint8_t *src = (const uint8_t *)data;
+    bool ok = true;
+    while (len) {
+        uint32_t n = LOG_WRITER_BUF_SIZE - w->fill;
+        if (n > len) n = len;
+        memcpy(w->buf + w->fill, src, n);
+        w->fill += n;
+        src += n;
+        len -= n;
+        if (w->fill == LOG_WRITER_BUF_SIZE) ok &= log_writer_flush_aligned(w);
+    }
+    return ok;
+}
+
+// Aplica a política de sincronização; chamada periodicamente pelo gravador
+void log_writer_poll(log_writer_t *w) {
+    // Lote que falhou na IRQ: regrava já, sem esperar o próximo encher
+    if (w->op_pending && w->op.done && w->op.status != SD_BLOCK_DEVICE_ERROR_NONE)
+        log_writer_wait(w);
+    bool due = false;
+    if (w->policy.sync_bytes && w->unsynced + w->fill >= w->policy.sync_bytes) due = true;
+    if (w->policy.sync_interval_ms && (w->unsynced || w->fill) &&
+        time_us_64() - w->last_sync_us >= (uint64_t)w->policy.sync_interval_ms * 1000) due = true;
+    if (due) log_writer_sync(w);
+}
+
+// Modo contíguo: o setor incompleto é gravado completado com zeros mas
+// permanece no buffer, e será regravado inteiro quando encher. O f_sync do
+// checkpoint fecha o CMD25; o próximo lote reabre a sessão nesse setor.
+static FRESULT log_writer_sync_direct(log_writer_t *w) {
+    log_writer_flush_aligned(w);
+    log_writer_wait(w);
+    if (w->fill && w->pos + LOG_WRITER_SECTOR <= w->capacity) {
+        memset(w->buf + w->fill, 0, LOG_WRITER_SECTOR - w->fill);
+        w->writes++;
+        LBA_t lba = w->base_lba + (LBA_t)(w->pos / LOG_WRITER_SECTOR);
+        if (sd_stream_write(w->card, w->buf, lba, 1) != SD_BLOCK_DEVICE_ERROR_NONE) {
+            w->errors++;
+            w->last_error = FR_DISK_ERR;
+        }
+    }
+    return log_writer_commit_size(w, w->pos + w->fill);
+}
+
+// Grava inclusive o setor incompleto e atualiza FAT e diretório. Retorna
+// só as falhas deste sync; last_error fica para as estatísticas.
+FRESULT log_writer_sync(log_writer_t *w) {
+    uint32_t errors = w->errors;
+    FRESULT fr;
+    LATENCY_BEGIN(start);
+    if (w->direct) {
+        fr = log_writer_sync_direct(w);
+    } else {
+        if (w->fill) log_writer_write(w, w->fill);
+        fr = f_sync(w->fil);
+    }
+    LATENCY_END(LAT_SYNC, start);
+    w->syncs++;
+    if (fr != FR_OK) {
+        w->errors++;
+        w->last_error = fr;
+    }
+    w->unsynced = 0;
+    w->last_sync_us = time_us_64();
+    return w->errors != errors ? w->last_error : FR_OK;
+}
+
+// Encerra o arquivo. No modo contíguo o arquivo é truncado no tamanho útil,
+// devolvendo ao volume os clusters pré-alocados que sobraram.
+FRESULT log_writer_end(log_writer_t *w) {
+    FRESULT fr = log_writer_sync(w);
+    if (w->direct) {
+        FSIZE_t size = w->pos + w->fill;
+        FRESULT tr = sd_stream_end(w->card) == SD_BLOCK_DEVICE_ERROR_NONE ? FR_OK : FR_DISK_ERR;
+        if (tr == FR_OK) tr = f_lseek(w->fil, size);
+        if (tr == FR_OK) tr = f_truncate(w->fil);
+        if (tr == FR_OK) tr = f_sync(w->fil);
+        if (tr != FR_OK) {
+            w->errors++;
+            w->last_error = fr = tr;
+        }
+        w->fill = 0;  // O setor final já foi gravado pelo sync
+        w->direct = false;
+        // O próximo sd_stream_begin zera os contadores do cartão
+        w->stream_blocks += w->card->stream_blocks;
+        w->stream_reopens += w->card->stream_reopens;
+    }
+    w->end_us = time_us_64();
+    return fr;
+}
+
+void log_writer_get_stats(const log_writer_t *w, log_writer_stats_t *stats) {
+    stats->bytes = w->bytes;
+    stats->writes = w->writes;
+    stats->syncs = w->syncs;
+    stats->errors = w->errors;
+    stats->retries = w->retries;
+    stats->stream_blocks = w->stream_blocks + (w->direct ? w->card->stream_blocks : 0);
+    stats->stream_reopens = w->stream_reopens + (w->direct ? w->card->stream_reopens : 0);
+    uint64_t end = w->end_us ? w->end_us : time_us_64();
+    stats->elapsed_ms = (uint32_t)((end - w->start_us) / 1000);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+#include "sd_card.h"
+
+// Buffer de escrita adiada entre o gravador e o FatFs. Os registros são
+// acumulados em RAM e entregues ao f_write em múltiplos inteiros de setor,
+// alinhados à posição do arquivo: assim o FatFs grava direto do buffer no
+// cartão, sem passar pela janela interna de 512 bytes. O f_sync (que
+// regrava FAT e diretório) segue uma política em vez de rodar a cada amostra.
+//
+// Uma sessão (log_writer_begin) pode passar por vários arquivos, abertos um
+// de cada vez com log_writer_open e encerrados com log_writer_end; as
+// estatísticas são da sessão inteira.
+//
+// No modo contíguo (log_writer_open com capacity) o arquivo é pré-alocado com
+// f_expand e os setores vão direto para os LBAs consecutivos numa sessão
+// CMD25 mantida aberta pelo driver do cartão (sd_stream_write);
+// FAT e diretório só são tocados nos checkpoints (f_sync) e ao encerrar.
+// Os lotes saem com sd_write_blocks_async a partir de um buffer duplo: o
+// gravador continua esvaziando o anel enquanto o cartão programa os setores.
+// Se a energia cair entre checkpoints, o arquivo fica com o tamanho do
+// último checkpoint e os clusters restantes ficam perdidos até um chkdsk.
+
+#define LOG_WRITER_SECTOR   512
+// Múltiplo de LOG_WRITER_SECTOR; de preferência do tamanho do cluster
+#define LOG_WRITER_BUF_SIZE 4096
+
+typedef struct {
+    uint32_t sync_interval_ms;  // Sincroniza a cada N ms (0: desativado)
+    uint32_t sync_bytes;        // Sincroniza a cada N bytes gravados (0: desativado)
+} log_sync_policy_t;
+
+typedef struct {
+    uint32_t bytes;          // Bytes entregues ao f_write
+    uint32_t writes;         // Chamadas de f_write
+    uint32_t syncs;          // Chamadas de f_sync
+    uint32_t errors;         // Falhas do FatFs
+    uint32_t retries;        // Modo contíguo: lotes regravados após falha na IRQ
+    uint32_t stream_blocks;  // Modo contíguo: blocos gravados via CMD25
+    uint32_t stream_reopens; // Modo contíguo: CMD25 reabertos (checkpoints)
+    uint32_t elapsed_ms;     // Duração da sessão
+} log_writer_stats_t;
+
+typedef struct {
+    FIL *fil;
+    log_sync_policy_t policy;
+    uint8_t bufs[2][LOG_WRITER_BUF_SIZE] __attribute__((aligned(4)));
+    uint8_t *buf;             // Lado em preenchimento; o outro pode estar em voo
+    uint32_t fill;
+    uint32_t unsynced;       // Bytes gravados desde o último f_sync
+    uint64_t start_us, end_us;
+    uint64_t last_sync_us;
+    uint32_t bytes, writes, syncs, errors, retries;
+    uint32_t stream_blocks, stream_reopens; // Dos arquivos contíguos já encerrados
+    FRESULT last_error;
+
+    // Modo contíguo
+    bool direct;
+    sd_card_t *card;
+    sd_async_op_t op;        // Último lote enviado
+    bool op_pending;
+    LBA_t base_lba;          // Primeiro setor da extensão pré-alocada
+    FSIZE_t capacity;        // Bytes pré-alocados
+    FSIZE_t pos;             // Bytes já gravados no cartão (múltiplo de setor)
+} log_writer_t;
+
+// Zera as estatísticas: início de uma sessão
+void log_writer_begin(log_writer_t *w, const log_sync_policy_t *policy);
+// Passa a gravar em um arquivo recém-criado. Com capacity > 0 tenta o modo
+// contíguo; sem espaço contíguo retorna o erro e segue com f_write.
+FRESULT log_writer_open(log_writer_t *w, FIL *fil, FSIZE_t capacity);
+// Tamanho do arquivo atual, contando o que ainda está no buffer
+FSIZE_t log_writer_size(const log_writer_t *w);
+bool log_writer_append(log_writer_t *w, const void *data, uint32_t len);
+void log_writer_poll(log_writer_t *w);
+FRESULT log_writer_sync(log_writer_t *w);
+FRESULT log_writer_end(log_writer_t *w);
+void log_writer_get_stats(const log_writer_t *w, log_writer_stats_t *stats);
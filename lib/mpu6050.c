@@ -0,0 +1,328 @@
+#include "mpu6050.h"
+
+// Etapas da leitura assíncrona da FIFO
+enum { MPU6050_ASYNC_STATUS, MPU6050_ASYNC_COUNT, MPU6050_ASYNC_DATA, MPU6050_ASYNC_RESET };
+
+void mpu6050_init(mpu6050_t *mpu, i2c_inst_t *i2c, uint8_t address) {
+    mpu->i2c_port = i2c;
+    mpu->address = address;
+    mpu->odr_hz = 0;
+    mpu->fifo_enabled = false;
+    mpu->fifo_overflows = 0;
+    mpu->fifo_bursts = 0;
+    mpu->fifo_frames = 0;
+    mpu->dma = NULL;
+    mpu->async_busy = false;
+}
+
+// As funções bloqueantes esperam o fim de uma leitura assíncrona em curso,
+// pois o controlador não pode ser compartilhado com o DMA
+void mpu6050_write_reg(mpu6050_t *mpu, uint8_t reg, uint8_t value) {
+    uint8_t buf[] = {reg, value};
+    if (mpu->dma) i2c_dma_wait_idle(mpu->dma);
+    i2c_write_blocking(mpu->i2c_port, mpu->address, buf, 2, false);
+}
+
+// false se o sensor não respondeu (NAK) ou a leitura veio incompleta
+bool mpu6050_read_regs(mpu6050_t *mpu, uint8_t reg, uint8_t *buf, size_t len) {
+    if (mpu->dma) i2c_dma_wait_idle(mpu->dma);
+    return i2c_write_blocking(mpu->i2c_port, mpu->address, &reg, 1, true) == 1 &&
+           i2c_read_blocking(mpu->i2c_port, mpu->address, buf, len, false) == (int)len;
+}
+
+void mpu6050_reset(mpu6050_t *mpu) {
+    mpu6050_write_reg(mpu, MPU6050_REG_PWR_MGMT_1, 0x00);
+}
+
+// Lê acelerômetro, temperatura e giroscópio (0x3B..0x48) em uma só rajada
+bool mpu6050_read_raw(mpu6050_t *mpu, int16_t accel[3], int16_t gyro[3]) {
+    uint8_t buffer[14];
+    if (!mpu6050_read_regs(mpu, MPU6050_REG_ACCEL_XOUT_H, buffer, sizeof(buffer))) return false;
+    for (int i = 0; i < 3; i++) {
+        accel[i] = (buffer[i * 2] << 8 | buffer[i * 2 + 1]);
+        gyro[i] = (buffer[8 + i * 2] << 8 | buffer[8 + i * 2 + 1]);
+    }
+    return true;
+}
+
+// Com o DLPF em 184 Hz a base do giroscópio é 1 kHz; ODR = 1 kHz / (1 + div)
+bool mpu6050_set_odr(mpu6050_t *mpu, uint16_t odr_hz) {
+    if (odr_hz == 0 || odr_hz > MPU6050_MAX_ODR_HZ) return false;
+    mpu6050_write_reg(mpu, MPU6050_REG_CONFIG, 0x01);
+    mpu6050_write_reg(mpu, MPU6050_REG_SMPLRT_DIV, MPU6050_MAX_ODR_HZ / odr_hz - 1);
+    mpu->odr_hz = MPU6050_MAX_ODR_HZ / (MPU6050_MAX_ODR_HZ / odr_hz);
+    return true;
+}
+
+// Configura o pino INT (nível, push-pull/dreno aberto, pulso ou travado)
+void mpu6050_config_int_pin(mpu6050_t *mpu, uint8_t pin_cfg) {
+    mpu6050_write_reg(mpu, MPU6050_REG_INT_PIN_CFG, pin_cfg);
+}
+
+// Habilita as fontes de interrupção (MPU6050_INT_DATA_RDY, ..._FIFO_OFLOW)
+void mpu6050_enable_interrupts(mpu6050_t *mpu, uint8_t mask) {
+    mpu6050_write_reg(mpu, MPU6050_REG_INT_ENABLE, mask);
+}
+
+void mpu6050_fifo_reset(mpu6050_t *mpu) {
+    uint8_t ctrl = mpu->fifo_enabled ? MPU6050_USER_CTRL_FIFO_EN : 0;
+    mpu6050_write_reg(mpu, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RST);
+    mpu6050_write_reg(mpu, MPU6050_REG_USER_CTRL, ctrl);
+}
+
+void mpu6050_fifo_enable(mpu6050_t *mpu) {
+    mpu->fifo_enabled = true;
+    mpu6050_write_reg(mpu, MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_ACCEL | MPU6050_FIFO_EN_GYRO);
+    mpu6050_fifo_reset(mpu);
+    // Limpa um eventual estouro anterior ao reset
+    mpu6050_fifo_overflowed(mpu);
+}
+
+void mpu6050_fifo_disable(mpu6050_t *mpu) {
+    mpu->fifo_enabled = false;
+    mpu6050_write_reg(mpu, MPU6050_REG_FIFO_EN, 0x00);
+    mpu6050_fifo_reset(mpu);
+}
+
+uint16_t mpu6050_fifo_count(mpu6050_t *mpu) {
+    uint8_t buf[2];
+    if (!mpu6050_read_regs(mpu, MPU6050_REG_FIFO_COUNTH, buf, 2)) return 0;
+    return (uint16_t)(buf[0] << 8 | buf[1]);
+}
+
+// INT_STATUS é limpo na leitura; o estouro é contabilizado em fifo_overflows
+bool mpu6050_fifo_overflowed(mpu6050_t *mpu) {
+    uint8_t status;
+    if (!mpu6050_read_regs(mpu, MPU6050_REG_INT_STATUS, &status, 1)) return false;
+    if (status & MPU6050_INT_FIFO_OFLOW) {
+        mpu->fifo_overflows++;
+        return true;
+    }
+    return false;
+}
+
+static void mpu6050_decode_frames(const uint8_t *buf, mpu6050_frame_t *frames, int n) {
+    for (int f = 0; f < n; f++) {
+        const uint8_t *p = &buf[f * MPU6050_FIFO_FRAME_SIZE];
+        for (int i = 0; i < 3; i++) {
+            frames[f].accel[i] = (p[i * 2] << 8 | p[i * 2 + 1]);
+            frames[f].gyro[i] = (p[6 + i * 2] << 8 | p[6 + i * 2 + 1]);
+        }
+    }
+}
+
+// Esvazia até max_frames quadros completos da FIFO. Após um estouro o
+// alinhamento dos quadros se perde, então a FIFO é reiniciada e o lote
+// descartado. Retorna o número de quadros lidos, ou -1 se uma rajada falhou
+// no barramento (a FIFO é reiniciada, pois o alinhamento também se perde).
+int mpu6050_fifo_read(mpu6050_t *mpu, mpu6050_frame_t *frames, int max_frames) {
+    if (mpu6050_fifo_overflowed(mpu)) {
+        mpu6050_fifo_reset(mpu);
+        return 0;
+    }
+    int available = mpu6050_fifo_count(mpu) / MPU6050_FIFO_FRAME_SIZE;
+    if (available > max_frames) available = max_frames;
+
+    uint8_t buffer[MPU6050_FIFO_BURST_BYTES];
+    int done = 0;
+    while (done < available) {
+        int n = available - done;
+        if (n > MPU6050_FIFO_BURST_FRAMES) n = MPU6050_FIFO_BURST_FRAMES;
+        mpu->fifo_bursts++;
+        if (!mpu6050_read_regs(mpu, MPU6050_REG_FIFO_R_W, buffer, n * MPU6050_FIFO_FRAME_SIZE)) {
+            mpu6050_fifo_reset(mpu);
+            return -1;
+        }
+        mpu6050_decode_frames(buffer, &frames[done], n);
+        done += n;
+    }
+    mpu->fifo_frames += done;
+    return done;
+}
+
+// --- LEITURA ASSÍNCRONA DA FIFO (DMA) ---
+
+void mpu6050_attach_dma(mpu6050_t *mpu, i2c_dma_t *dma) {
+    mpu->dma = dma;
+}
+
+static void mpu6050_async_finish(mpu6050_t *mpu, int frames) {
+    if (frames > 0) mpu->fifo_frames += frames;
+    mpu->async_busy = false;
+    if (mpu->async_cb) mpu->async_cb(mpu, frames, mpu->async_user);
+}
+
+static void mpu6050_async_step(i2c_dma_xfer_t *xfer);
+
+static void mpu6050_async_read(mpu6050_t *mpu, uint8_t stage, uint8_t reg, uint32_t len) {
+    mpu->async_stage = stage;
+    mpu->xfer.addr = mpu->address;
+    mpu->xfer.cmds = mpu->cmds;
+    mpu->xfer.cmd_count = i2c_dma_build_read_reg(mpu->cmds, reg, len);
+    mpu->xfer.rx = mpu->rx;
+    mpu->xfer.rx_count = len;
+    mpu->xfer.callback = mpu6050_async_step;
+    mpu->xfer.user_data = mpu;
+    if (!i2c_dma_submit(mpu->dma, &mpu->xfer)) mpu6050_async_finish(mpu, -1);
+}
+
+static void mpu6050_async_read_data(mpu6050_t *mpu) {
+    int n = mpu->async_remaining;
+    if (n > MPU6050_FIFO_BURST_FRAMES) n = MPU6050_FIFO_BURST_FRAMES;
+    mpu6050_async_read(mpu, MPU6050_ASYNC_DATA, MPU6050_REG_FIFO_R_W, n * MPU6050_FIFO_FRAME_SIZE);
+}
+
+// Reinicia a FIFO com duas escritas em USER_CTRL enfileiradas de uma vez
+static void mpu6050_async_reset(mpu6050_t *mpu) {
+    uint8_t ctrl = mpu->fifo_enabled ? MPU6050_USER_CTRL_FIFO_EN : 0;
+    mpu->reset_cmds[0] = MPU6050_REG_USER_CTRL;
+    mpu->reset_cmds[1] = MPU6050_USER_CTRL_FIFO_RST | I2C_IC_DATA_CMD_STOP_BITS;
+    mpu->reset_cmds[2] = MPU6050_REG_USER_CTRL;
+    mpu->reset_cmds[3] = ctrl | I2C_IC_DATA_CMD_STOP_BITS;
+
+    mpu->async_stage = MPU6050_ASYNC_RESET;
+    mpu->xfer_aux = (i2c_dma_xfer_t){ .addr = mpu->address, .cmds = &mpu->reset_cmds[0], .cmd_count = 2 };
+    mpu->xfer = (i2c_dma_xfer_t){ .addr = mpu->address, .cmds = &mpu->reset_cmds[2], .cmd_count = 2,
+                                  .callback = mpu6050_async_step, .user_data = mpu };
+    if (!i2c_dma_submit(mpu->dma, &mpu->xfer_aux) || !i2c_dma_submit(mpu->dma, &mpu->xfer))
+        mpu6050_async_finish(mpu, -1);
+}
+
+// Avança a cadeia INT_STATUS -> FIFO_COUNT -> dados a cada transação concluída
+static void mpu6050_async_step(i2c_dma_xfer_t *xfer) {
+    mpu6050_t *mpu = (mpu6050_t *)xfer->user_data;
+    if (xfer->status != I2C_DMA_DONE) {
+        mpu6050_async_finish(mpu, -1);
+        return;
+    }
+
+    switch (mpu->async_stage) {
+        case MPU6050_ASYNC_STATUS:
+            if (mpu->rx[0] & MPU6050_INT_FIFO_OFLOW) {
+                mpu->fifo_overflows++;
+                mpu6050_async_reset(mpu);
+                return;
+            }
+            mpu6050_async_read(mpu, MPU6050_ASYNC_COUNT, MPU6050_REG_FIFO_COUNTH, 2);
+            return;
+
+        case MPU6050_ASYNC_COUNT: {
+            int available = (mpu->rx[0] << 8 | mpu->rx[1]) / MPU6050_FIFO_FRAME_SIZE;
+            if (available > mpu->async_remaining) available = mpu->async_remaining;
+            mpu->async_remaining = available;
+            if (!available) {
+                mpu6050_async_finish(mpu, 0);
+                return;
+            }
+            mpu6050_async_read_data(mpu);
+            return;
+        }
+
+        case MPU6050_ASYNC_DATA: {
+            int n = xfer->rx_count / MPU6050_FIFO_FRAME_SIZE;
+            mpu->fifo_bursts++;
+            mpu6050_decode_frames(mpu->rx, &mpu->async_frames[mpu->async_done], n);
+            mpu->async_done += n;
+            mpu->async_remaining -= n;
+            if (mpu->async_remaining) {
+                mpu6050_async_read_data(mpu);
+                return;
+            }
+            mpu6050_async_finish(mpu, mpu->async_done);
+            return;
+        }
+
+        default:
+            // Após um estouro o lote é descartado, como em mpu6050_fifo_read
+            mpu6050_async_finish(mpu, 0);
+            return;
+    }
+}
+
+// Mesma semântica de mpu6050_fifo_read, mas o barramento é percorrido pelo
+// DMA e o resultado chega em cb. Retorna false se já houver uma leitura em
+// curso ou se o DMA não foi associado.
+bool mpu6050_fifo_read_async(mpu6050_t *mpu, mpu6050_frame_t *frames, int max_frames,
+                             mpu6050_fifo_cb_t cb, void *user) {
+    if (!mpu->dma || mpu->async_busy || max_frames <= 0) return false;
+    mpu->async_busy = true;
+    mpu->async_frames = frames;
+    mpu->async_remaining = max_frames;
+    mpu->async_done = 0;
+    mpu->async_cb = cb;
+    mpu->async_user = user;
+    mpu6050_async_read(mpu, MPU6050_ASYNC_STATUS, MPU6050_REG_INT_STATUS, 1);
+    return true;
+}
+
+// --- ESTATÍSTICAS DE REPOUSO (CALIBRAÇÃO) ---
+
+void mpu6050_stats_reset(mpu6050_stats_t *st) {
+    st->n = 0;
+    for (int i = 0; i < MPU6050_AXES; i++) {
+        st->sum[i] = 0;
+        st->sum_sq[i] = 0;
+    }
+}
+
+void mpu6050_stats_add(mpu6050_stats_t *st, const mpu6050_frame_t *frame) {
+    for (int i = 0; i < 3; i++) {
+        int32_t a = frame->accel[i], g = frame->gyro[i];
+        st->sum[i] += a;
+        st->sum_sq[i] += (uint64_t)(a * a);
+        st->sum[i + 3] += g;
+        st->sum_sq[i + 3] += (uint64_t)(g * g);
+    }
+    st->n++;
+}
+
+// Arredondada para o inteiro mais próximo
+int32_t mpu6050_stats_mean(const mpu6050_stats_t *st, int axis) {
+    if (!st->n) return 0;
+    int64_t s = st->sum[axis];
+    int64_t half = st->n / 2;
+    return (int32_t)((s >= 0 ? s + half : s - half) / (int64_t)st->n);
+}
+
+// (Σx² - (Σx)²/n) / (n - 1)
+uint32_t mpu6050_stats_var(const mpu6050_stats_t *st, int axis) {
+    if (st->n < 2) return 0;
+    int64_t s = st->sum[axis];
+    uint64_t sq = (uint64_t)(s < 0 ? -s : s);
+    uint64_t dev = st->sum_sq[axis] - sq * sq / st->n;
+    uint64_t var = dev / (st->n - 1);
+    return var > UINT32_MAX ? UINT32_MAX : (uint32_t)var;
+}
+
+// Tempo para a FIFO juntar uma rajada na ODR máxima, com folga para a
+// leitura não disputar espaço com o sensor (1024 B = 85 quadros)
+#define MPU6050_STATS_POLL_MS 20
+
+bool mpu6050_collect_stats(mpu6050_t *mpu, uint32_t frames, mpu6050_stats_t *st) {
+    uint16_t odr = mpu->odr_hz;
+    mpu6050_frame_t burst[MPU6050_FIFO_BURST_FRAMES];
+    mpu6050_set_odr(mpu, MPU6050_MAX_ODR_HZ);
+    mpu6050_fifo_enable(mpu);
+
+    // A primeira rajada é descartada: o filtro do sensor ainda reflete a ODR anterior
+    sleep_ms(MPU6050_STATS_POLL_MS);
+    mpu6050_fifo_read(mpu, burst, MPU6050_FIFO_BURST_FRAMES);
+
+    // Prazo: o dobro do tempo nominal
+    absolute_time_t deadline = make_timeout_time_ms(2 * frames * 1000 / MPU6050_MAX_ODR_HZ + 100);
+    uint32_t target = st->n + frames;
+    while (st->n < target && absolute_time_diff_us(get_absolute_time(), deadline) > 0) {
+        sleep_ms(MPU6050_STATS_POLL_MS);
+        while (st->n < target) {
+            int max = target - st->n < MPU6050_FIFO_BURST_FRAMES ? (int)(target - st->n)
+                                                                 : MPU6050_FIFO_BURST_FRAMES;
+            int n = mpu6050_fifo_read(mpu, burst, max);
+            for (int f = 0; f < n; f++) mpu6050_stats_add(st, &burst[f]);
+            if (n < max) break;
+        }
+    }
+
+    mpu6050_fifo_disable(mpu);
+    if (odr) mpu6050_set_odr(mpu, odr);
+    return st->n >= target;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "i2c_dma.h"
+
+// Registradores usados pelo driver
+typedef enum {
+    MPU6050_REG_SMPLRT_DIV   = 0x19,
+    MPU6050_REG_CONFIG       = 0x1A,
+    MPU6050_REG_GYRO_CONFIG  = 0x1B,
+    MPU6050_REG_ACCEL_CONFIG = 0x1C,
+    MPU6050_REG_FIFO_EN      = 0x23,
+    MPU6050_REG_INT_PIN_CFG  = 0x37,
+    MPU6050_REG_INT_ENABLE   = 0x38,
+    MPU6050_REG_INT_STATUS   = 0x3A,
+    MPU6050_REG_ACCEL_XOUT_H = 0x3B,
+    MPU6050_REG_GYRO_XOUT_H  = 0x43,
+    MPU6050_REG_USER_CTRL    = 0x6A,
+    MPU6050_REG_PWR_MGMT_1   = 0x6B,
+    MPU6050_REG_FIFO_COUNTH  = 0x72,
+    MPU6050_REG_FIFO_R_W     = 0x74,
+    MPU6050_REG_WHO_AM_I     = 0x75
+} mpu6050_reg_t;
+
+#define MPU6050_FIFO_EN_ACCEL      (1 << 3)
+#define MPU6050_FIFO_EN_GYRO       (0x07 << 4)  // XG, YG, ZG
+#define MPU6050_USER_CTRL_FIFO_EN  (1 << 6)
+#define MPU6050_USER_CTRL_FIFO_RST (1 << 2)
+#define MPU6050_INT_FIFO_OFLOW     (1 << 4)
+#define MPU6050_INT_DATA_RDY       (1 << 0)
+#define MPU6050_INT_PIN_ACTIVE_LOW (1 << 7)
+#define MPU6050_INT_PIN_OPEN_DRAIN (1 << 6)
+#define MPU6050_INT_PIN_LATCH      (1 << 5)
+#define MPU6050_INT_PIN_RD_CLEAR   (1 << 4)
+
+#define MPU6050_FIFO_SIZE        1024
+#define MPU6050_FIFO_FRAME_SIZE  12   // accel xyz + gyro xyz, 16 bits cada
+#define MPU6050_MAX_ODR_HZ       1000 // Taxa do giroscópio com o DLPF ativo
+// Maior rajada lida da FIFO em uma única transação I2C
+#define MPU6050_FIFO_BURST_FRAMES 32
+#define MPU6050_FIFO_BURST_BYTES  (MPU6050_FIFO_BURST_FRAMES * MPU6050_FIFO_FRAME_SIZE)
+
+typedef struct {
+    int16_t accel[3];
+    int16_t gyro[3];
+} mpu6050_frame_t;
+
+typedef struct mpu6050 mpu6050_t;
+// Fim de uma leitura assíncrona da FIFO: frames é o número de quadros
+// entregues (0 após um estouro) ou -1 se a transação I2C foi abortada.
+// Chamada no contexto da IRQ do I2C.
+typedef void (*mpu6050_fifo_cb_t)(mpu6050_t *mpu, int frames, void *user);
+
+struct mpu6050 {
+    i2c_inst_t *i2c_port;
+    uint8_t address;
+    uint16_t odr_hz;
+    bool fifo_enabled;
+    uint32_t fifo_overflows;  // Estouros da FIFO detectados via INT_STATUS
+    uint32_t fifo_bursts;     // Transações de leitura da FIFO
+    uint32_t fifo_frames;     // Quadros lidos da FIFO
+
+    // Leitura assíncrona da FIFO via DMA (mpu6050_attach_dma)
+    i2c_dma_t *dma;
+    i2c_dma_xfer_t xfer, xfer_aux;
+    uint16_t cmds[1 + MPU6050_FIFO_BURST_BYTES];
+    uint16_t reset_cmds[4];
+    uint8_t rx[MPU6050_FIFO_BURST_BYTES];
+    volatile bool async_busy;
+    uint8_t async_stage;
+    mpu6050_frame_t *async_frames;
+    int async_remaining, async_done;
+    mpu6050_fifo_cb_t async_cb;
+    void *async_user;
+};
+
+void mpu6050_init(mpu6050_t *mpu, i2c_inst_t *i2c, uint8_t address);
+void mpu6050_reset(mpu6050_t *mpu);
+void mpu6050_write_reg(mpu6050_t *mpu, uint8_t reg, uint8_t value);
+bool mpu6050_read_regs(mpu6050_t *mpu, uint8_t reg, uint8_t *buf, size_t len);
+bool mpu6050_read_raw(mpu6050_t *mpu, int16_t accel[3], int16_t gyro[3]);
+bool mpu6050_set_odr(mpu6050_t *mpu, uint16_t odr_hz);
+void mpu6050_config_int_pin(mpu6050_t *mpu, uint8_t pin_cfg);
+void mpu6050_enable_interrupts(mpu6050_t *mpu, uint8_t mask);
+
+void mpu6050_fifo_enable(mpu6050_t *mpu);
+void mpu6050_fifo_disable(mpu6050_t *mpu);
+void mpu6050_fifo_reset(mpu6050_t *mpu);
+uint16_t mpu6050_fifo_count(mpu6050_t *mpu);
+bool mpu6050_fifo_overflowed(mpu6050_t *mpu);
+int mpu6050_fifo_read(mpu6050_t *mpu, mpu6050_frame_t *frames, int max_frames);
+
+void mpu6050_attach_dma(mpu6050_t *mpu, i2c_dma_t *dma);
+bool mpu6050_fifo_read_async(mpu6050_t *mpu, mpu6050_frame_t *frames, int max_frames,
+                             mpu6050_fifo_cb_t cb, void *user);
+
+// --- ESTATÍSTICAS DE REPOUSO (CALIBRAÇÃO) ---
+
+// Eixos 0..2: acelerômetro; 3..5: giroscópio
+#define MPU6050_AXES 6
+
+// Média e variância por eixo, acumuladas quadro a quadro. As somas são
+// inteiras de 64 bits e exatas: sem ponto flutuante no M0+ e sem perda
+// de precisão por cancelamento.
+typedef struct {
+    uint32_t n;
+    int64_t sum[MPU6050_AXES];
+    uint64_t sum_sq[MPU6050_AXES];
+} mpu6050_stats_t;
+
+void mpu6050_stats_reset(mpu6050_stats_t *st);
+void mpu6050_stats_add(mpu6050_stats_t *st, const mpu6050_frame_t *frame);
+int32_t mpu6050_stats_mean(const mpu6050_stats_t *st, int axis);
+// Variância amostral em LSB²
+uint32_t mpu6050_stats_var(const mpu6050_stats_t *st, int axis);
+
+// Coleta 'frames' quadros pela FIFO na ODR máxima, em rajadas de
+// MPU6050_FIFO_BURST_FRAMES, e os acumula em 'st'. A ODR anterior é
+// restaurada e a FIFO desligada ao final. Bloqueante e sem DMA: usar antes
+// de mpu6050_attach_dma ou com o amostrador parado. Retorna false se o
+// sensor não entregou os quadros no prazo.
+bool mpu6050_collect_stats(mpu6050_t *mpu, uint32_t frames, mpu6050_stats_t *st);
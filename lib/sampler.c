@@ -0,0 +1,193 @@
+#include <string.h>
+#include "sampler.h"
+
+static void sampler_record_jitter(sampler_t *s, int64_t jitter) {
+    if (jitter < s->jitter_min_us) s->jitter_min_us = (int32_t)jitter;
+    if (jitter > s->jitter_max_us) s->jitter_max_us = (int32_t)jitter;
+    s->jitter_abs_sum_us += (uint64_t)(jitter < 0 ? -jitter : jitter);
+    s->jitter_count++;
+    if (jitter > s->period_us / 2) s->late++;
+}
+
+// Instante do quadro gerado 'back' amostras antes do disparo 'tick'. No
+// modo externo cada quadro teve a sua interrupção DATA_RDY, e vale o instante
+// capturado nela, com o jitter e a deriva entre os relógios. Sem ela (timer,
+// quadro anterior ao início ou instante já sobrescrito) o instante é
+// extrapolado do disparo pelo período nominal.
+static uint64_t sampler_frame_time(const sampler_t *s, uint32_t tick, uint32_t back, uint64_t now) {
+    if (s->external && back <= tick && s->ticks - (tick - back) <= SAMPLER_TRIGGER_HISTORY)
+        return s->trigger_us[(tick - back) % SAMPLER_TRIGGER_HISTORY];
+    return now - (uint64_t)(back * s->sample_period_us);
+}
+
+// O último quadro da rajada corresponde ao disparo; os anteriores, às
+// interrupções que o precederam.
+static void sampler_publish_burst(sampler_t *s, int n, uint64_t now, uint32_t tick) {
+    if (n < 0) {
+        s->read_errors++;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        imu_sample_t *sample = &s->burst_buf[i];
+        sample->seq = ++s->next_seq;
+        sample->timestamp_us = sampler_frame_time(s, tick, (uint32_t)(n - 1 - i), now);
+        spsc_ring_push(&s->ring, sample);
+    }
+}
+
+// Lê o sensor e publica as amostras na fila; now é o instante do disparo
+static void sampler_acquire(sampler_t *s, uint64_t now, uint32_t tick) {
+    if (s->burst) {
+        // Com uma rajada assíncrona ainda no barramento o disparo é pulado;
+        // as amostras continuam na FIFO do sensor para a próxima.
+        if (s->burst_pending) return;
+        s->burst_trigger_us = now;
+        s->burst_trigger_tick = tick;
+        s->burst_pending = true;
+        int n = s->burst(s->burst_buf, SAMPLER_MAX_BURST, s->ctx);
+        if (n == SAMPLER_BURST_ASYNC) return;
+        s->burst_pending = false;
+        sampler_publish_burst(s, n, now, tick);
+        return;
+    }
+
+    // Um disparo por amostra: lacunas na sequência revelam falhas de leitura
+    imu_sample_t sample;
+    sample.seq = tick + 1;
+    sample.timestamp_us = now;
+    if (!s->read(&sample, s->ctx)) {
+        s->read_errors++;
+        return;
+    }
+    spsc_ring_push(&s->ring, &sample);
+}
+
+static bool sampler_timer_callback(repeating_timer_t *rt) {
+    sampler_t *s = (sampler_t *)rt->user_data;
+    uint64_t now = time_us_64();
+    uint32_t tick = s->ticks++;
+
+    // Desvio do disparo em relação à grade ideal start + n * período
+    sampler_record_jitter(s, (int64_t)(now - s->start_us) - (int64_t)tick * s->period_us);
+    sampler_acquire(s, now, tick);
+    return s->running;
+}
+
+// Chamada da interrupção do pino INT do sensor (DATA_RDY), com o instante
+// capturado logo na entrada da IRQ. No modo rajada a FIFO só é esvaziada a
+// cada 'watermark' interrupções.
+void sampler_data_ready(sampler_t *s, uint64_t timestamp_us) {
+    if (!s->running || !s->external) return;
+    uint32_t tick = s->ticks++;
+    // Aqui o jitter é medido entre interrupções consecutivas do sensor
+    if (tick) {
+        uint64_t prev = s->trigger_us[(tick - 1) % SAMPLER_TRIGGER_HISTORY];
+        sampler_record_jitter(s, (int64_t)(timestamp_us - prev) - s->sample_period_us);
+    }
+    s->trigger_us[tick % SAMPLER_TRIGGER_HISTORY] = timestamp_us;
+    if (++s->pending_triggers < s->watermark) return;
+    s->pending_triggers = 0;
+    sampler_acquire(s, timestamp_us, tick);
+}
+
+// Conclusão de uma rajada que retornou SAMPLER_BURST_ASYNC: as n amostras
+// já estão em burst_buf (n < 0 indica falha). Chamada no contexto da IRQ
+// que terminou a leitura.
+void sampler_burst_done(sampler_t *s, int n) {
+    if (!s->burst_pending) return;
+    sampler_publish_burst(s, n, s->burst_trigger_us, s->burst_trigger_tick);
+    s->burst_pending = false;
+}
+
+bool sampler_init(sampler_t *s, uint32_t odr_hz, sampler_read_fn read, void *ctx) {
+    if (odr_hz == 0 || odr_hz > SAMPLER_MAX_ODR_HZ || !read) return false;
+    memset(s, 0, sizeof(*s));
+    s->odr_hz = odr_hz;
+    s->sample_period_us = 1000000 / odr_hz;
+    s->period_us = s->sample_period_us;
+    s->read = read;
+    s->ctx = ctx;
+    s->watermark = 1;
+    return spsc_ring_init(&s->ring, s->storage, sizeof(imu_sample_t), SAMPLER_RING_LEN);
+}
+
+// Cada disparo entrega no máximo metade do buffer de rajada, deixando
+// folga para as amostras que chegam enquanto a anterior é lida
+bool sampler_burst_valid(uint32_t odr_hz, uint32_t poll_hz) {
+    return odr_hz && odr_hz <= SAMPLER_MAX_ODR_HZ && poll_hz &&
+           odr_hz / poll_hz <= SAMPLER_MAX_BURST / 2;
+}
+
+// O timer dispara a poll_hz e cada disparo entrega as amostras acumuladas
+// no sensor desde o anterior.
+bool sampler_init_burst(sampler_t *s, uint32_t odr_hz, uint32_t poll_hz,
+                        sampler_burst_fn burst, void *ctx) {
+    if (!sampler_burst_valid(odr_hz, poll_hz) || !burst) return false;
+    memset(s, 0, sizeof(*s));
+    s->odr_hz = odr_hz;
+    s->sample_period_us = 1000000 / odr_hz;
+    s->period_us = 1000000 / poll_hz;
+    s->burst = burst;
+    s->ctx = ctx;
+    s->watermark = 1;
+    return spsc_ring_init(&s->ring, s->storage, sizeof(imu_sample_t), SAMPLER_RING_LEN);
+}
+
+// Troca o timer pelas interrupções DATA_RDY do sensor (sampler_data_ready).
+// 'watermark' é o número de amostras acumuladas na FIFO antes de cada
+// rajada; no modo de leitura única deve ser 1.
+bool sampler_set_external_trigger(sampler_t *s, uint32_t watermark) {
+    if (watermark == 0 || (!s->burst && watermark != 1)) return false;
+    if (watermark > SAMPLER_MAX_BURST / 2) return false;
+    s->external = true;
+    s->watermark = watermark;
+    s->period_us = s->sample_period_us;
+    return true;
+}
+
+bool sampler_start(sampler_t *s) {
+    spsc_ring_reset(&s->ring);
+    s->ticks = s->read_errors = s->late = 0;
+    s->next_seq = 0;
+    s->jitter_min_us = INT32_MAX;
+    s->jitter_max_us = INT32_MIN;
+    s->jitter_abs_sum_us = 0;
+    s->jitter_count = 0;
+    s->pending_triggers = 0;
+    s->burst_pending = false;
+    s->running = true;
+    if (s->external) return true;
+    // Período negativo: o próximo disparo é agendado a partir do anterior,
+    // sem acumular o tempo gasto no callback.
+    s->start_us = time_us_64() + s->period_us;
+    if (!add_repeating_timer_us(-s->period_us, sampler_timer_callback, s, &s->timer)) {
+        s->running = false;
+        return false;
+    }
+    return true;
+}
+
+void sampler_stop(sampler_t *s) {
+    s->running = false;
+    if (!s->external) cancel_repeating_timer(&s->timer);
+}
+
+// Pode ser chamada de outro núcleo: a fila é SPSC sem travas
+bool sampler_pop(sampler_t *s, imu_sample_t *out) {
+    return spsc_ring_pop(&s->ring, out);
+}
+
+uint32_t sampler_pending(const sampler_t *s) {
+    return spsc_ring_count(&s->ring);
+}
+
+void sampler_get_stats(const sampler_t *s, sampler_stats_t *stats) {
+    stats->ticks = s->ticks;
+    stats->dropped = s->ring.overflows;
+    stats->ring_high_water = s->ring.high_water;
+    stats->read_errors = s->read_errors;
+    stats->late = s->late;
+    stats->jitter_min_us = s->jitter_count ? s->jitter_min_us : 0;
+    stats->jitter_max_us = s->jitter_count ? s->jitter_max_us : 0;
+    stats->jitter_avg_us = s->jitter_count ? (uint32_t)(s->jitter_abs_sum_us / s->jitter_count) : 0;
+}
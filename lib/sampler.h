@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "spsc_ring.h"
+
+// Taxa máxima suportada pelo motor de amostragem (Hz)
+#define SAMPLER_MAX_ODR_HZ  1000
+// Capacidade da fila entre aquisição e gravação (potência de 2). Com
+// 1024 amostras a fila absorve ~1 s de cartão ocupado a 1 kHz.
+#define SAMPLER_RING_LEN    1024
+// Máximo de amostras entregues por disparo no modo rajada
+#define SAMPLER_MAX_BURST   32
+// Instantes de DATA_RDY guardados para datar os quadros da FIFO: uma rajada
+// inteira, com folga para as interrupções que chegam durante a leitura
+#define SAMPLER_TRIGGER_HISTORY (2 * SAMPLER_MAX_BURST)
+
+typedef struct {
+    uint32_t seq;           // Número sequencial atribuído no disparo do timer
+    uint64_t timestamp_us;  // Instante da aquisição (time_us_64)
+    int16_t accel[3];
+    int16_t gyro[3];
+} imu_sample_t;
+
+// Lê uma amostra do sensor; chamada no contexto de interrupção do timer.
+typedef bool (*sampler_read_fn)(imu_sample_t *sample, void *ctx);
+// Modo rajada: lê até max amostras já acumuladas no sensor (FIFO) e
+// retorna quantas foram escritas em out. Também chamada pelo timer.
+// Pode retornar SAMPLER_BURST_ASYNC se a leitura seguir em segundo plano;
+// nesse caso o resultado é entregue depois com sampler_burst_done.
+typedef int (*sampler_burst_fn)(imu_sample_t *out, int max, void *ctx);
+#define SAMPLER_BURST_ASYNC (-2)
+
+typedef struct {
+    uint32_t ticks;          // Disparos do timer desde o início
+    uint32_t dropped;        // Amostras perdidas por fila cheia
+    uint32_t ring_high_water; // Maior ocupação da fila
+    uint32_t read_errors;    // Falhas de leitura do sensor
+    uint32_t late;           // Disparos com atraso maior que meio período
+                             // (no modo externo: interrupções perdidas)
+    int32_t jitter_min_us;   // Menor desvio em relação ao instante ideal
+    int32_t jitter_max_us;   // Maior desvio em relação ao instante ideal
+    uint32_t jitter_avg_us;  // Média do desvio absoluto
+} sampler_stats_t;
+
+typedef struct {
+    uint32_t odr_hz;           // Taxa das amostras
+    int64_t sample_period_us;  // Intervalo entre amostras
+    int64_t period_us;         // Intervalo entre disparos do timer
+    sampler_read_fn read;
+    sampler_burst_fn burst;
+    void *ctx;
+    imu_sample_t burst_buf[SAMPLER_MAX_BURST];
+    uint32_t next_seq;
+    volatile bool burst_pending;  // Rajada assíncrona em andamento
+    uint64_t burst_trigger_us;    // Instante do disparo dessa rajada
+    uint32_t burst_trigger_tick;  // E o seu número
+    repeating_timer_t timer;
+    volatile bool running;
+    bool external;              // Disparado pelo pino INT do sensor
+    uint32_t watermark;         // Interrupções por leitura no modo externo
+    uint32_t pending_triggers;
+    uint64_t trigger_us[SAMPLER_TRIGGER_HISTORY]; // Por disparo, indexado por tick
+
+    spsc_ring_t ring;
+    imu_sample_t storage[SAMPLER_RING_LEN];
+
+    uint64_t start_us;
+    volatile uint32_t ticks, read_errors, late;
+    volatile int32_t jitter_min_us, jitter_max_us;
+    volatile uint64_t jitter_abs_sum_us;
+    volatile uint32_t jitter_count;
+} sampler_t;
+
+bool sampler_init(sampler_t *s, uint32_t odr_hz, sampler_read_fn read, void *ctx);
+bool sampler_init_burst(sampler_t *s, uint32_t odr_hz, uint32_t poll_hz,
+                        sampler_burst_fn burst, void *ctx);
+// Combinação de taxa e disparos aceita por sampler_init_burst
+bool sampler_burst_valid(uint32_t odr_hz, uint32_t poll_hz);
+bool sampler_set_external_trigger(sampler_t *s, uint32_t watermark);
+void sampler_data_ready(sampler_t *s, uint64_t timestamp_us);
+void sampler_burst_done(sampler_t *s, int n);
+bool sampler_start(sampler_t *s);
+void sampler_stop(sampler_t *s);
+bool sampler_pop(sampler_t *s, imu_sample_t *out);
+uint32_t sampler_pending(const sampler_t *s);
+void sampler_get_stats(const sampler_t *s, sampler_stats_t *stats);
@@ -0,0 +1,45 @@
+#include <string.h>
+#include "hardware/sync.h"
+#include "spsc_ring.h"
+
+bool spsc_ring_init(spsc_ring_t *r, void *storage, uint32_t elem_size, uint32_t capacity) {
+    if (!storage || !elem_size || !capacity || (capacity & (capacity - 1))) return false;
+    r->storage = storage;
+    r->elem_size = elem_size;
+    r->mask = capacity - 1;
+    spsc_ring_reset(r);
+    return true;
+}
+
+// Só deve ser chamada com produtor e consumidor parados
+void spsc_ring_reset(spsc_ring_t *r) {
+    r->head = r->tail = 0;
+    r->high_water = 0;
+    r->overflows = 0;
+}
+
+bool spsc_ring_push(spsc_ring_t *r, const void *elem) {
+    uint32_t head = r->head;
+    uint32_t used = head - r->tail;
+    if (used > r->mask) {
+        r->overflows++;
+        return false;
+    }
+    memcpy(r->storage + (head & r->mask) * r->elem_size, elem, r->elem_size);
+    // Garante que o elemento esteja visível ao outro núcleo antes do índice
+    __dmb();
+    r->head = head + 1;
+    if (used + 1 > r->high_water) r->high_water = used + 1;
+    return true;
+}
+
+bool spsc_ring_pop(spsc_ring_t *r, void *elem) {
+    uint32_t tail = r->tail;
+    if (tail == r->head) return false;
+    __dmb();
+    memcpy(elem, r->storage + (tail & r->mask) * r->elem_size, r->elem_size);
+    // Libera a posição só depois de copiar o elemento
+    __dmb();
+    r->tail = tail + 1;
+    return true;
+}
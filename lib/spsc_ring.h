@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+// Fila circular sem travas para um produtor e um consumidor, que podem
+// estar em núcleos diferentes. A capacidade deve ser potência de 2.
+typedef struct {
+    uint8_t *storage;
+    uint32_t elem_size;
+    uint32_t mask;
+    volatile uint32_t head;        // Escrito apenas pelo produtor
+    volatile uint32_t tail;        // Escrito apenas pelo consumidor
+    volatile uint32_t high_water;  // Maior ocupação observada
+    volatile uint32_t overflows;   // Inserções rejeitadas por fila cheia
+} spsc_ring_t;
+
+bool spsc_ring_init(spsc_ring_t *r, void *storage, uint32_t elem_size, uint32_t capacity);
+void spsc_ring_reset(spsc_ring_t *r);
+bool spsc_ring_push(spsc_ring_t *r, const void *elem);
+bool spsc_ring_pop(spsc_ring_t *r, void *elem);
+
+static inline uint32_t spsc_ring_count(const spsc_ring_t *r) {
+    return r->head - r->tail;
+}
+
+static inline uint32_t spsc_ring_capacity(const spsc_ring_t *r) {
+    return r->mask + 1;
+}
@@ -1,3 +1,5 @@
+#include <string.h>
+#include "hardware/sync.h"
 #include "ssd1306.h"
 #include "font.h"
 
@@ -11,6 +13,34 @@ void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_v
   ssd->ram_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
   ssd->ram_buffer[0] = 0x40;
   ssd->port_buffer[0] = 0x80;
+  ssd->dma = NULL;
+  ssd->dma_cmds = NULL;
+  ssd->xfer_count = 0;
+  ssd->last_xfer = NULL;
+  ssd->frame_done = true;
+  ssd->frame_pending = false;
+  ssd->shadow = calloc(ssd->bufsize - 1, sizeof(uint8_t));
+  ssd->full_refresh = true; // Conteúdo da GDDRAM desconhecido após o reset
+  ssd->frames = ssd->full_frames = ssd->frames_deferred = 0;
+  ssd->bytes_sent = ssd->bytes_saved = 0;
+  ssd->last_saved = 0;
+}
+
+// Janela de endereçamento enviada antes de cada faixa: 6 comandos
+#define SSD1306_WINDOW_CMDS 6
+
+// A partir daqui os envios apenas enfileiram as transações e retornam. O
+// buffer de palavras é o buffer de envio: o quadro é copiado para ele na
+// troca e ram_buffer pode ser redesenhado logo em seguida. Ele comporta
+// uma faixa de largura total em cada página, o pior caso do envio parcial.
+bool ssd1306_attach_dma(ssd1306_t *ssd, i2c_dma_t *dma) {
+  size_t words = ssd->pages * (SSD1306_WINDOW_CMDS * 2 + 1 + ssd->width);
+  if (words < SSD1306_WINDOW_CMDS * 2 + ssd->bufsize) words = SSD1306_WINDOW_CMDS * 2 + ssd->bufsize;
+  ssd->dma_cmds = malloc(words * sizeof(uint16_t));
+  if (!ssd->dma_cmds) return false;
+  ssd->xfer_count = 0;
+  ssd->dma = dma;
+  return true;
 }
 
 void ssd1306_config(ssd1306_t *ssd) {
@@ -42,6 +72,7 @@ void ssd1306_config(ssd1306_t *ssd) {
 }
 
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
+  if (ssd->dma) i2c_dma_wait_idle(ssd->dma);
   ssd->port_buffer[1] = command;
   i2c_write_blocking(
     ssd->i2c_port,
@@ -52,23 +83,187 @@ void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
   );
 }
 
+// Uma transação falha deixa a GDDRAM desconhecida: o próximo envio é inteiro
+void ssd1306_wait(ssd1306_t *ssd) {
+  for (int i = 0; i < ssd->xfer_count; i++)
+    if (!i2c_dma_wait(&ssd->xfers[i])) ssd->full_refresh = true;
+  ssd->xfer_count = 0;
+}
+
+// Bytes no barramento por faixa além dos dados: com DMA, endereço, 6 pares
+// (0x80, comando) e o 0x40; sem DMA, a janela vai em uma transação própria
+// (endereço, 0x00 e 6 comandos) e os dados em outra (endereço e 0x40)
+static uint32_t ssd1306_span_overhead(const ssd1306_t *ssd) {
+  return ssd->dma ? 1 + SSD1306_WINDOW_CMDS * 2 + 1 : 1 + 1 + SSD1306_WINDOW_CMDS + 2;
+}
+
+static uint32_t ssd1306_full_bytes(const ssd1306_t *ssd) {
+  return ssd1306_span_overhead(ssd) - 1 + ssd->bufsize;
+}
+
+// IRQ do I2C: a fila é FIFO, então o quadro terminou quando a última
+// transação dele terminar. O __sev acorda um laço parado em __wfe.
+static void ssd1306_xfer_done(i2c_dma_xfer_t *xfer) {
+  ssd1306_t *ssd = (ssd1306_t *)xfer->user_data;
+  if (xfer != ssd->last_xfer) return;
+  ssd->frame_done = true;
+  __sev();
+}
+
+// Com DMA, comandos e dados seguem em uma única transação: cada comando vai
+// precedido do byte de controle 0x80 e os dados do 0x40. Como um 0x40 sem
+// Co encerra os comandos da transação, cada faixa é uma transação.
+static bool ssd1306_submit_dma(ssd1306_t *ssd, uint16_t *cmds, const uint8_t *data, uint32_t len,
+                               uint8_t col0, uint8_t col1, uint8_t page0, uint8_t page1) {
+  const uint8_t window[SSD1306_WINDOW_CMDS] = {
+    SET_COL_ADDR, col0, col1, SET_PAGE_ADDR, page0, page1
+  };
+  i2c_dma_xfer_t *xfer = &ssd->xfers[ssd->xfer_count++];
+  uint16_t *start = cmds;
+  for (int i = 0; i < SSD1306_WINDOW_CMDS; i++) {
+    *cmds++ = 0x80;
+    *cmds++ = window[i];
+  }
+  cmds += i2c_dma_build_write(cmds, data, len, true);
+
+  xfer->addr = ssd->address;
+  xfer->cmds = start;
+  xfer->cmd_count = cmds - start;
+  xfer->rx = NULL;
+  xfer->rx_count = 0;
+  xfer->callback = ssd1306_xfer_done;
+  xfer->user_data = ssd;
+  ssd->frame_done = false;
+  ssd->last_xfer = xfer;
+  if (i2c_dma_submit(ssd->dma, xfer)) return true;
+
+  // Fila cheia: o quadro termina na transação anterior, que pode já ter
+  // terminado sem ver que era a última
+  xfer->status = I2C_DMA_IDLE;
+  ssd->full_refresh = true;
+  uint32_t irq = save_and_disable_interrupts();
+  i2c_dma_xfer_t *prev = xfer == ssd->xfers ? NULL : xfer - 1;
+  ssd->last_xfer = prev;
+  if (!prev || (prev->status != I2C_DMA_QUEUED && prev->status != I2C_DMA_BUSY))
+    ssd->frame_done = true;
+  restore_interrupts(irq);
+  return false;
+}
+
+static bool ssd1306_window_blocking(ssd1306_t *ssd, uint8_t col0, uint8_t col1, uint8_t page0, uint8_t page1) {
+  uint8_t cmds[1 + SSD1306_WINDOW_CMDS] = {
+    0x00, SET_COL_ADDR, col0, col1, SET_PAGE_ADDR, page0, page1
+  };
+  return i2c_write_blocking(ssd->i2c_port, ssd->address, cmds, sizeof(cmds), false) == sizeof(cmds);
+}
+
+void ssd1306_send_data_full(ssd1306_t *ssd) {
+  if (ssd->dma) {
+    // O quadro anterior ainda pode estar saindo do buffer de palavras
+    ssd1306_wait(ssd);
+    ssd->full_refresh = !ssd1306_submit_dma(ssd, ssd->dma_cmds, ssd->ram_buffer, ssd->bufsize,
+                                            0, ssd->width - 1, 0, ssd->pages - 1);
+  } else {
+    ssd->full_refresh = !ssd1306_window_blocking(ssd, 0, ssd->width - 1, 0, ssd->pages - 1) ||
+      i2c_write_blocking(ssd->i2c_port, ssd->address, ssd->ram_buffer, ssd->bufsize, false) != (int)ssd->bufsize;
+  }
+  memcpy(ssd->shadow, ssd->ram_buffer + 1, ssd->bufsize - 1);
+  ssd->frames++;
+  ssd->full_frames++;
+  ssd->bytes_sent += ssd1306_full_bytes(ssd);
+  ssd->last_saved = 0;
+}
+
+// Colunas alteradas de cada página em relação à GDDRAM; retorna os bytes
+// que o envio parcial colocaria no barramento
+static uint32_t ssd1306_find_dirty(ssd1306_t *ssd) {
+  const uint8_t *ram = ssd->ram_buffer + 1;
+  for (int p = 0; p < ssd->pages; p++) {
+    ssd->dirty_lo[p] = 0xFF;
+    ssd->dirty_hi[p] = 0;
+  }
+  for (int x = 0; x < ssd->width; x++) {
+    const uint8_t *col = ram + (x << 3);
+    const uint8_t *old = ssd->shadow + (x << 3);
+    for (int p = 0; p < ssd->pages; p++) {
+      if (col[p] == old[p]) continue;
+      if (ssd->dirty_lo[p] == 0xFF) ssd->dirty_lo[p] = x;
+      ssd->dirty_hi[p] = x;
+    }
+  }
+  uint32_t bytes = 0;
+  for (int p = 0; p < ssd->pages; p++)
+    if (ssd->dirty_lo[p] != 0xFF)
+      bytes += ssd1306_span_overhead(ssd) + ssd->dirty_hi[p] - ssd->dirty_lo[p] + 1;
+  return bytes;
+}
+
+// Troca: compara ram_buffer com a GDDRAM e copia as faixas alteradas para
+// o buffer de envio. Só com o envio anterior concluído.
+static void ssd1306_send_frame(ssd1306_t *ssd) {
+  ssd->frame_pending = false;
+  uint32_t full = ssd1306_full_bytes(ssd);
+  uint32_t bytes = ssd->full_refresh ? full : ssd1306_find_dirty(ssd);
+  if (bytes >= full) {
+    ssd1306_send_data_full(ssd);
+    return;
+  }
+  // Nada mudou: não conta como quadro
+  if (!bytes) {
+    ssd->last_saved = full;
+    return;
+  }
+  ssd->frames++;
+  ssd->bytes_sent += bytes;
+  ssd->last_saved = full - bytes;
+  ssd->bytes_saved += full - bytes;
+
+  // Cada faixa é uma página: em endereçamento vertical, com a janela de uma
+  // página só a coluna avança
+  uint16_t *cmds = ssd->dma_cmds;
+  uint8_t span[1 + WIDTH];
+  span[0] = 0x40;
+  for (int p = 0; p < ssd->pages; p++) {
+    if (ssd->dirty_lo[p] == 0xFF) continue;
+    uint8_t lo = ssd->dirty_lo[p], hi = ssd->dirty_hi[p];
+    uint32_t len = 1;
+    for (int x = lo; x <= hi; x++) {
+      uint16_t i = (x << 3) + p;
+      ssd->shadow[i] = ssd->ram_buffer[i + 1];
+      span[len++] = ssd->shadow[i];
+    }
+    if (ssd->dma) {
+      if (!ssd1306_submit_dma(ssd, cmds, span, len, lo, hi, p, p)) return;
+      cmds += SSD1306_WINDOW_CMDS * 2 + len;
+    } else if (!ssd1306_window_blocking(ssd, lo, hi, p, p) ||
+               i2c_write_blocking(ssd->i2c_port, ssd->address, span, len, false) != (int)len) {
+      ssd->full_refresh = true;
+    }
+  }
+}
+
 void ssd1306_send_data(ssd1306_t *ssd) {
-  ssd1306_command(ssd, SET_COL_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->width - 1);
-  ssd1306_command(ssd, SET_PAGE_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->pages - 1);
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->ram_buffer,
-    ssd->bufsize,
-    false
-  );
+  // Antes de comparar: a cópia da GDDRAM só vale com o envio anterior concluído
+  if (ssd->dma) ssd1306_wait(ssd);
+  ssd1306_send_frame(ssd);
+}
+
+bool ssd1306_present(ssd1306_t *ssd) {
+  if (ssd->dma && !ssd->frame_done) {
+    if (!ssd->frame_pending) ssd->frames_deferred++;
+    ssd->frame_pending = true;
+    return false;
+  }
+  ssd1306_send_data(ssd);
+  return true;
+}
+
+bool ssd1306_poll(ssd1306_t *ssd) {
+  return ssd->frame_pending && ssd1306_present(ssd);
 }
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
+  if (x >= ssd->width || y >= ssd->height) return;
   uint16_t index = (y >> 3) + (x << 3) + 1;
   uint8_t pixel = (y & 0b111);
   if (value)
@@ -77,44 +272,69 @@ void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
     ssd->ram_buffer[index] &= ~(1 << pixel);
 }
 
-/*
-void ssd1306_fill(ssd1306_t *ssd, bool value) {
-  uint8_t byte = value ? 0xFF : 0x00;
-  for (uint8_t i = 1; i < ssd->bufsize; ++i)
-    ssd->ram_buffer[i] = byte;
-}*/
+// As primitivas abaixo trabalham em bytes: cada byte de ram_buffer é uma
+// coluna de 8 pixels de uma página e as colunas vizinhas ficam a 8 bytes
+// de distância (endereçamento vertical).
 
-void ssd1306_fill(ssd1306_t *ssd, bool value) {
-    // Itera por todas as posições do display
-    for (uint8_t y = 0; y < ssd->height; ++y) {
-        for (uint8_t x = 0; x < ssd->width; ++x) {
-            ssd1306_pixel(ssd, x, y, value);
-        }
-    }
+// Bits das linhas y0..y1 (já limitadas ao display) dentro da página
+static uint8_t ssd1306_page_mask(uint8_t page, uint8_t y0, uint8_t y1) {
+  uint8_t lo = page == (y0 >> 3) ? (y0 & 7) : 0;
+  uint8_t hi = page == (y1 >> 3) ? (y1 & 7) : 7;
+  return (uint8_t)((0xFF << lo) & (0xFF >> (7 - hi)));
 }
 
+// Escreve os bits de 'mask' nas colunas x0..x1 de uma página
+static void ssd1306_page_fill(ssd1306_t *ssd, uint8_t page, uint8_t x0, uint8_t x1, uint8_t mask, bool value) {
+  uint8_t *b = &ssd->ram_buffer[page + (x0 << 3) + 1];
+  if (mask == 0xFF) {
+    uint8_t byte = value ? 0xFF : 0x00;
+    for (int x = x0; x <= x1; ++x, b += 8) *b = byte;
+  } else if (value) {
+    for (int x = x0; x <= x1; ++x, b += 8) *b |= mask;
+  } else {
+    for (int x = x0; x <= x1; ++x, b += 8) *b &= ~mask;
+  }
+}
 
+// Área x0..x1, y0..y1 com os extremos recortados ao display
+static void ssd1306_area(ssd1306_t *ssd, int x0, int x1, int y0, int y1, bool value) {
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 >= ssd->width) x1 = ssd->width - 1;
+  if (y1 >= ssd->height) y1 = ssd->height - 1;
+  if (x0 > x1 || y0 > y1) return;
+  for (int page = y0 >> 3; page <= (y1 >> 3); ++page)
+    ssd1306_page_fill(ssd, page, x0, x1, ssd1306_page_mask(page, y0, y1), value);
+}
 
-void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
-  for (uint8_t x = left; x < left + width; ++x) {
-    ssd1306_pixel(ssd, x, top, value);
-    ssd1306_pixel(ssd, x, top + height - 1, value);
-  }
-  for (uint8_t y = top; y < top + height; ++y) {
-    ssd1306_pixel(ssd, left, y, value);
-    ssd1306_pixel(ssd, left + width - 1, y, value);
-  }
+void ssd1306_fill(ssd1306_t *ssd, bool value) {
+  memset(ssd->ram_buffer + 1, value ? 0xFF : 0x00, ssd->bufsize - 1);
+}
 
+void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
+  if (!width || !height) return;
+  int right = left + width - 1, bottom = top + height - 1;
   if (fill) {
-    for (uint8_t x = left + 1; x < left + width - 1; ++x) {
-      for (uint8_t y = top + 1; y < top + height - 1; ++y) {
-        ssd1306_pixel(ssd, x, y, value);
-      }
-    }
+    ssd1306_area(ssd, left, right, top, bottom, value);
+    return;
   }
+  ssd1306_area(ssd, left, right, top, top, value);
+  ssd1306_area(ssd, left, right, bottom, bottom, value);
+  ssd1306_area(ssd, left, left, top, bottom, value);
+  ssd1306_area(ssd, right, right, top, bottom, value);
 }
 
 void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, bool value) {
+    // Horizontais e verticais saem por páginas
+    if (y0 == y1) {
+        ssd1306_hline(ssd, x0 < x1 ? x0 : x1, x0 < x1 ? x1 : x0, y0, value);
+        return;
+    }
+    if (x0 == x1) {
+        ssd1306_vline(ssd, x0, y0 < y1 ? y0 : y1, y0 < y1 ? y1 : y0, value);
+        return;
+    }
+
     int dx = abs(x1 - x0);
     int dy = abs(y1 - y0);
 
@@ -144,39 +364,36 @@ void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1
 
 
 void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
-  for (uint8_t x = x0; x <= x1; ++x)
-    ssd1306_pixel(ssd, x, y, value);
+  ssd1306_area(ssd, x0, x1, y, y, value);
 }
 
 void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
-  for (uint8_t y = y0; y <= y1; ++y)
-    ssd1306_pixel(ssd, x, y, value);
+  ssd1306_area(ssd, x, x, y0, y1, value);
 }
 
 // Função para desenhar um caractere
 void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y)
 {
-  uint16_t index = 0;
+  // Fora da faixa ASCII imprimível desenha um espaço (índice 0)
+  const uint8_t *glyph = font;
+  if (c >= ' ' && c <= '~') glyph += (c - ' ') * 8;
+  if (x >= ssd->width || y >= ssd->height) return;
 
-  // Verifica o caractere e calcula o índice correspondente na fonte
-  if (c >= ' ' && c <= '~') // Verifica se o caractere está na faixa ASCII válida
-  {
-    index = (c - ' ') * 8; // Calcula o índice baseado na posição do caractere na tabela ASCII
-  }
-  else
-  {
-    // Caractere inválido, desenha um espaço (ou pode ser tratado de outra forma)
-    index = 0; // Índice 0 corresponde ao caractere "nada" (espaço)
+  // Cada byte da fonte já é uma coluna de 8 pixels, no formato da GDDRAM
+  uint8_t cols = ssd->width - x < 8 ? ssd->width - x : 8;
+  uint8_t page = y >> 3, shift = y & 7;
+  uint8_t *b = &ssd->ram_buffer[page + (x << 3) + 1];
+  if (!shift) {
+    for (uint8_t i = 0; i < cols; ++i, b += 8) *b = glyph[i];
+    return;
   }
 
-  // Desenha o caractere na tela
-  for (uint8_t i = 0; i < 8; ++i)
-  {
-    uint8_t line = font[index + i]; // Acessa a linha correspondente do caractere na fonte
-    for (uint8_t j = 0; j < 8; ++j)
-    {
-      ssd1306_pixel(ssd, x + i, y + j, line & (1 << j)); // Desenha cada pixel do caractere
-    }
+  // Fora do alinhamento o glifo ocupa o fim de uma página e o início da seguinte
+  uint8_t mask = 0xFF << shift;
+  bool next = page + 1 < ssd->pages;
+  for (uint8_t i = 0; i < cols; ++i, b += 8) {
+    b[0] = (b[0] & ~mask) | (uint8_t)(glyph[i] << shift);
+    if (next) b[1] = (b[1] & mask) | (glyph[i] >> (8 - shift));
   }
 }
 
@@ -197,4 +414,4 @@ void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y)
       break;
     }
   }
-}
\ No newline at end of file
+}
@@ -1,6 +1,9 @@
+#pragma once
+
 #include <stdlib.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "i2c_dma.h"
 
 #define WIDTH 128
 #define HEIGHT 64
@@ -25,6 +28,9 @@ typedef enum {
   SET_CHARGE_PUMP = 0x8D
 } ssd1306_command_t;
 
+// Uma transação por página alterada no envio parcial
+#define SSD1306_MAX_XFERS 8
+
 typedef struct {
   uint8_t width, height, pages, address;
   i2c_inst_t *i2c_port;
@@ -32,12 +38,44 @@ typedef struct {
   uint8_t *ram_buffer;
   size_t bufsize;
   uint8_t port_buffer[2];
+  i2c_dma_t *dma;         // Envio do quadro por DMA (ssd1306_attach_dma)
+  i2c_dma_xfer_t xfers[SSD1306_MAX_XFERS];
+  uint8_t xfer_count;     // Transações do último envio
+  i2c_dma_xfer_t *volatile last_xfer; // Última transação do quadro em curso
+  volatile bool frame_done; // Quadro anterior já saiu: o buffer de envio está livre
+  bool frame_pending;     // ram_buffer tem um quadro à espera de ssd1306_poll
+  uint16_t *dma_cmds;     // Janelas de endereçamento + dados em palavras de IC_DATA_CMD
+
+  // Envio parcial: o buffer é comparado com a cópia do que já está na
+  // GDDRAM e só as colunas alteradas de cada página vão para o barramento
+  uint8_t *shadow;        // Conteúdo do display, no layout de ram_buffer[1..]
+  uint8_t dirty_lo[8], dirty_hi[8]; // Colunas alteradas por página (lo > hi: limpa)
+  bool full_refresh;      // Próximo envio manda o quadro inteiro
+  uint32_t frames, full_frames; // Envios com alguma alteração; inteiros
+  uint32_t frames_deferred; // ssd1306_present com o envio anterior em curso
+  uint32_t bytes_sent;    // Bytes no barramento, incluindo endereço e comandos
+  uint32_t bytes_saved;   // Economia acumulada em relação a quadros inteiros
+  uint16_t last_saved;    // Economia do último ssd1306_send_data
 } ssd1306_t;
 
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c);
 void ssd1306_config(ssd1306_t *ssd);
 void ssd1306_command(ssd1306_t *ssd, uint8_t command);
+// Envia só as faixas alteradas desde o último envio; cai no quadro inteiro
+// quando ele sairia mais barato ou após uma falha no barramento. Com DMA,
+// espera o quadro anterior sair antes de montar o novo.
 void ssd1306_send_data(ssd1306_t *ssd);
+void ssd1306_send_data_full(ssd1306_t *ssd);
+// Versão que nunca espera (duplo buffer: ram_buffer é o de desenho e o
+// buffer de palavras do DMA o de envio). Se o quadro anterior ainda está
+// saindo, não troca os buffers, para não rasgar a imagem: marca o quadro
+// como pendente e retorna false. Sem DMA, igual a ssd1306_send_data.
+bool ssd1306_present(ssd1306_t *ssd);
+// Envia o quadro pendente se o anterior já saiu; true se enviou
+bool ssd1306_poll(ssd1306_t *ssd);
+// Aguarda o fim do envio por DMA em curso
+void ssd1306_wait(ssd1306_t *ssd);
+bool ssd1306_attach_dma(ssd1306_t *ssd, i2c_dma_t *dma);
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value);
 void ssd1306_fill(ssd1306_t *ssd, bool value);